@@ -1,6 +1,8 @@
 #ifndef CALL_H
 #define CALL_H
 
+#include <set>
+#include <queue>
 #include <fstream>
 #include <iomanip>
 
@@ -19,6 +21,7 @@
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/icl/split_interval_map.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/progress.hpp>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
@@ -35,12 +38,35 @@ namespace rayas
     uint32_t minSegDist;
     uint32_t minChrLen;
     uint32_t ploidy;
+    uint32_t maxDepth;
+    uint32_t counters;
+    bool compact;
+    bool pipeline;
+    bool doubleHash;
+    bool timing;
+    uint32_t threads;
+    uint32_t iothreads;
+    uint32_t linkmem;
     float contam;
     float sdthres;
+    std::string region;
+    std::string chr;
     boost::filesystem::path genome;
     boost::filesystem::path outfile;
+    boost::filesystem::path graph;
+    boost::filesystem::path bedfile;
+    boost::filesystem::path tmpdir;
+    boost::filesystem::path checkpointDir;
+    boost::filesystem::path partial;
+    boost::filesystem::path nmask;
+    boost::filesystem::path statsfile;
+    boost::filesystem::path tracks;
+    boost::filesystem::path dumpTracks;
     boost::filesystem::path tumor;
     boost::filesystem::path control;
+    std::vector<boost::filesystem::path> tumors;
+    std::vector<boost::filesystem::path> outfiles;
+    std::vector<boost::filesystem::path> graphs;
   };
 
   struct Breakpoint {
@@ -54,9 +80,8 @@ namespace rayas
  
 
   template<typename TBreakpoint>
-  struct SortBreakpoints : public std::binary_function<TBreakpoint, TBreakpoint, bool>
-  {
-    inline bool operator()(TBreakpoint const& bp1, TBreakpoint const& bp2) {
+  struct SortBreakpoints {
+    inline bool operator()(TBreakpoint const& bp1, TBreakpoint const& bp2) const {
       return ((bp1.pos < bp2.pos) || ((bp1.pos == bp2.pos) && (bp1.left)));
     }
   };
@@ -73,11 +98,28 @@ namespace rayas
   };
 
 
+  struct Region {
+    int32_t tid;
+    uint32_t start;
+    uint32_t end;
+
+    Region(int32_t const t, uint32_t const s, uint32_t const e) : tid(t), start(s), end(e) {}
+  };
+
+  template<typename TRegion>
+  struct SortRegions {
+    inline bool operator()(TRegion const& r1, TRegion const& r2) const {
+      return ((r1.tid < r2.tid) || ((r1.tid == r2.tid) && (r1.start < r2.start)));
+    }
+  };
+
+
   inline bool
   mappedReads(hts_idx_t* idx, int32_t refIndex, std::string const& str) {
     // Any data?
     std::string suffix("cram");
     if ((str.size() >= suffix.size()) && (str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0)) return true;
+    if (idx == NULL) return false;
     uint64_t mapped = 0;
     uint64_t unmapped = 0;
     hts_idx_get_stat(idx, refIndex, &mapped, &unmapped);
@@ -85,20 +127,67 @@ namespace rayas
     else return false;
   }
   
-  template<typename TConfig, typename TVector, typename TChrReadPos>
+  // Only flag, position, mapping quality, CIGAR and read name are used, CRAM skips decoding sequence, qualities and tags
   inline void
-  parseChr(TConfig& c, samFile* samfile, hts_idx_t* idx, bam_hdr_t* hdr, int32_t refIndex, TVector& left, TVector& right, TVector& cov, TChrReadPos& read1, TChrReadPos& read2, bool const trackreads) {
-    typedef typename TVector::value_type TValue;
-    // Max value
-    TValue maxval = std::numeric_limits<TValue>::max();
+  requiredFields(samFile* fp) {
+    hts_set_opt(fp, CRAM_OPT_REQUIRED_FIELDS, SAM_QNAME | SAM_FLAG | SAM_RNAME | SAM_POS | SAM_MAPQ | SAM_CIGAR);
+    hts_set_opt(fp, CRAM_OPT_DECODE_MD, 0);
+  }
 
+  inline bool
+  hasClip(bam1_t const* rec, uint32_t const minClip) {
+    uint32_t const* cigar = bam_get_cigar(rec);
+    for (std::size_t i = 0; i < rec->core.n_cigar; ++i) {
+      if (((bam_cigar_op(cigar[i]) == BAM_CSOFT_CLIP) || (bam_cigar_op(cigar[i]) == BAM_CHARD_CLIP)) && (bam_cigar_oplen(cigar[i]) >= minClip)) return true;
+    }
+    return false;
+  }
+
+  template<typename TConfig, typename TClips, typename TCoverage, typename TChrReadPos>
+  inline void
+  parseChr(TConfig& c, samFile* samfile, hts_idx_t* idx, int32_t refIndex, uint32_t const wstart, uint32_t const wend, TClips& left, TClips& right, TCoverage& cov, TChrReadPos& read1, TChrReadPos& read2, bool const trackreads, ParseStats& ps) {
+    // Clips and coverage are stored relative to wstart, tracked split-reads keep chromosome coordinates
     // Read alignments
-    hts_itr_t* iter = sam_itr_queryi(idx, refIndex, 0, hdr->target_len[refIndex]);
+    hts_itr_t* iter = sam_itr_queryi(idx, refIndex, wstart, wend);
     bam1_t* rec = bam_init1();
+    double cpu = threadCpu();
+
+    // Alignment ends and weights of the kept reads overlapping the current position, only used with a depth cap
+    typedef std::pair<uint32_t, uint32_t> TEndWeight;
+    std::priority_queue<TEndWeight, std::vector<TEndWeight>, std::greater<TEndWeight> > active;
+    uint64_t depth = 0;
     while (sam_itr_next(samfile, iter, rec) >= 0) {
-      if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FSECONDARY | BAM_FUNMAP)) continue;
-      if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
-      std::size_t seed = hash_string(bam_get_qname(rec));
+      ++ps.records;
+      if ((rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FSECONDARY | BAM_FUNMAP)) || (rec->core.qual < c.minMapQual) || (rec->core.tid<0)) {
+	++ps.filtered;
+	continue;
+      }
+      // The read name is only hashed for tracked split-reads
+      ReadId seed;
+      bool hashed = false;
+
+      // Beyond the depth cap, 1 in w unclipped reads is kept by name hash and counts w times, w is a power of two
+      // so the low hash bits nest: a mate kept at a deeper locus is also kept at a shallower one, not vice versa
+      // Clipped reads are always kept so that clip counts and split-read support stay exact
+      uint32_t w = 1;
+      if (c.maxDepth) {
+	while ((!active.empty()) && (active.top().first <= rec->core.pos)) {
+	  depth -= active.top().second;
+	  active.pop();
+	}
+	uint64_t q = (depth + c.maxDepth) / c.maxDepth;
+	while ((w < (1u << 31)) && ((uint64_t) w * 2 <= q)) w *= 2;
+	if ((w > 1) && (hasClip(rec, c.minClip))) w = 1;
+	if (w > 1) {
+	  seed = readId(rec, c.doubleHash);
+	  hashed = true;
+	  if ((seed.h1 >> 32) & (w - 1)) {
+	    ++ps.subsampled;
+	    continue;
+	  }
+	}
+      }
+      if (rec->core.pos > wstart) flushCoverage(cov, rec->core.pos - wstart);
 
       // Parse cigar
       uint32_t rp = rec->core.pos; // reference pointer
@@ -106,21 +195,26 @@ namespace rayas
       uint32_t* cigar = bam_get_cigar(rec);
       for (std::size_t i = 0; i < rec->core.n_cigar; ++i) {
 	if ((bam_cigar_op(cigar[i]) == BAM_CMATCH) || (bam_cigar_op(cigar[i]) == BAM_CEQUAL) || (bam_cigar_op(cigar[i]) == BAM_CDIFF)) {
-	  for(std::size_t k = 0; k<bam_cigar_oplen(cigar[i]); ++k, ++rp, ++sp) {
-	    if (cov[rp] < maxval) ++cov[rp];
+	  if ((rp + bam_cigar_oplen(cigar[i]) > wstart) && (rp < wend)) {
+	    uint32_t cst = std::max(rp, wstart);
+	    uint32_t cen = std::min(rp + bam_cigar_oplen(cigar[i]), wend);
+	    addCoverage(cov, cst - wstart, cen - cst, w);
 	  }
+	  rp += bam_cigar_oplen(cigar[i]);
+	  sp += bam_cigar_oplen(cigar[i]);
 	} else if (bam_cigar_op(cigar[i]) == BAM_CDEL) {
 	  rp += bam_cigar_oplen(cigar[i]);
 	} else if (bam_cigar_op(cigar[i]) == BAM_CINS) {
 	  sp += bam_cigar_oplen(cigar[i]);
 	} else if ((bam_cigar_op(cigar[i]) == BAM_CSOFT_CLIP) || (bam_cigar_op(cigar[i]) == BAM_CHARD_CLIP)) {
-	  if (bam_cigar_oplen(cigar[i]) >= c.minClip) {
-	    if (sp == 0) {
-	      if (left[rp] < maxval) left[rp] += 1;
-	    } else {
-	      if (right[rp] < maxval) right[rp] += 1;
-	    }
+	  if ((bam_cigar_oplen(cigar[i]) >= c.minClip) && (rp >= wstart) && (rp < wend)) {
+	    ++ps.clipped;
+	    if ((sp == 0) ? addClip(left, rp - wstart, w) : addClip(right, rp - wstart, w)) ps.saturated = true;
 	    if (trackreads) {
+	      if (!hashed) {
+		seed = readId(rec, c.doubleHash);
+		hashed = true;
+	      }
 	      // Allow same genomic position for read1 & read2 for self-concatenating templated insertions
 	      if (rec->core.flag & BAM_FREAD1) read1.push_back(std::make_pair(seed, rp));
 	      else read2.push_back(std::make_pair(seed, rp));
@@ -133,33 +227,160 @@ namespace rayas
 	  std::cerr << "Warning: Unknown Cigar operation!" << std::endl;
 	}
       }
+      if (c.maxDepth) {
+	active.push(std::make_pair(rp, w));
+	depth += w;
+      }
+      if (rp >= wstart) {
+	ps.spanStart = std::min(ps.spanStart, std::max((uint32_t) rec->core.pos, wstart) - wstart);
+	ps.spanEnd = std::max(ps.spanEnd, std::min(rp + 1, wend) - wstart);
+      }
     }
     bam_destroy1(rec);
     hts_itr_destroy(iter);
+    if (finishClips(left)) ps.saturated = true;
+    if (finishClips(right)) ps.saturated = true;
+    if (finishCoverage(cov, ps.spanStart, ps.spanEnd)) ps.saturated = true;
+    ps.cpu = threadCpu() - cpu;
   }
 
 
-  template<typename TBitSet, typename TVector>
-  inline void
-  covParams(TBitSet const& nrun, TVector const& cov, uint32_t const seedwin, uint32_t& avgcov, uint32_t& sdcov) {
-    // Collect coverage values
-    std::vector<uint32_t> vcov;
-    for(uint32_t i = seedwin; i < nrun.size(); i = i + seedwin) {
-      uint32_t lcov = 0;
-      bool ncontent = false;
-      for(uint32_t k = i - seedwin; k < i; ++k) {
-	if (nrun[k]) {
-	  ncontent = true;
-	  break;
+  struct NMask {
+    std::vector<uint64_t> bits;
+    std::vector<uint32_t> rank;
+
+    NMask() {}
+    NMask(uint32_t const len) : bits(len / 64 + 1, 0), rank(len / 64 + 2, 0) {}
+
+    // Clears the mask for reuse with a region of length len, rank is rewritten by build
+    inline void
+    reset(uint32_t const len) {
+      std::fill(bits.begin(), bits.end(), 0);
+      bits.resize(len / 64 + 1, 0);
+      rank.resize(len / 64 + 2, 0);
+    }
+
+    inline void
+    set(uint32_t const pos) {
+      bits[pos >> 6] |= (1ULL << (pos & 63));
+    }
+
+    // Sets all positions in [start, end), whole words at a time
+    inline void
+    set(uint32_t start, uint32_t const end) {
+      for(; (start < end) && (start & 63); ++start) set(start);
+      for(; start + 64 <= end; start += 64) bits[start >> 6] = std::numeric_limits<uint64_t>::max();
+      for(; start < end; ++start) set(start);
+    }
+
+    // Cumulative N counts per 64bp word, call after all N positions are set
+    inline void
+    build() {
+      for(uint32_t i = 0; i < bits.size(); ++i) rank[i+1] = rank[i] + __builtin_popcountll(bits[i]);
+    }
+
+    // Number of N's in [0, pos)
+    inline uint32_t
+    count(uint32_t const pos) const {
+      return rank[pos >> 6] + __builtin_popcountll(bits[pos >> 6] & ((1ULL << (pos & 63)) - 1));
+    }
+
+    inline bool
+    any(uint32_t const start, uint32_t const end) const {
+      return (count(end) != count(start));
+    }
+  };
+
+  // Background coverage of the control, computed once per region and shared by all tumors
+  struct ControlParams {
+    bool valid;
+    uint32_t avgcov;
+    uint32_t sdcov;
+
+    ControlParams() : valid(false), avgcov(0), sdcov(0) {}
+  };
+
+  // Per-worker region buffers, allocated once and reset between regions instead of being freed and zero-filled again
+  // Tumor buffers are slots, one per tumor if a region is loaded ahead of its analysis, else a single slot shared by all tumors
+  template<typename TValue, typename TChrReadPos>
+  struct RegionArena {
+    typedef typename CounterTraits<TValue>::TClip TClip;
+    typedef typename CounterTraits<TValue>::TCoverage TCoverage;
+    typedef typename CounterTraits<TValue>::TCumulative TCumulative;
+
+    uint32_t wstart;
+    uint32_t wend;
+    uint32_t rstart;
+    uint32_t rend;
+    bool saturated;
+    NMask nrun;
+    ControlParams cp;
+    std::vector<DenseTrack<TClip> > left;
+    std::vector<DenseTrack<TClip> > right;
+    std::vector<DenseTrack<TCoverage> > cov;
+    std::vector<SpanPrefixSum<TCumulative> > cumcov;
+    std::vector<SparseCounts<TClip> > sleft;
+    std::vector<SparseCounts<TClip> > sright;
+    std::vector<CompactCoverage<TCoverage> > scov;
+    std::vector<TChrReadPos> r1;
+    std::vector<TChrReadPos> r2;
+    DenseTrack<TClip> cleft;
+    DenseTrack<TClip> cright;
+    DenseTrack<TCoverage> ccov;
+    SpanPrefixSum<TCumulative> ccumcov;
+    SparseCounts<TClip> scleft;
+    SparseCounts<TClip> scright;
+    CompactCoverage<TCoverage> sccov;
+    std::vector<Breakpoint> bpvec;
+    std::vector<uint32_t> cand;
+
+    // Dense tracks are only reserved, pages are touched by the first region that needs them
+    RegionArena(uint32_t const maxlen, bool const dense, uint32_t const slots) : wstart(0), wend(0), rstart(0), rend(0), saturated(false), left(slots), right(slots), cov(slots), cumcov(slots), sleft(slots), sright(slots), scov(slots), r1(slots), r2(slots) {
+      if (dense) {
+	for(uint32_t s = 0; s < slots; ++s) {
+	  left[s].data.reserve(maxlen);
+	  right[s].data.reserve(maxlen);
+	  cov[s].data.reserve(maxlen);
+	  cumcov[s].sums.reserve(maxlen + 1);
 	}
-	lcov += cov[k];
+	cleft.data.reserve(maxlen);
+	cright.data.reserve(maxlen);
+	ccov.data.reserve(maxlen);
+	ccumcov.sums.reserve(maxlen + 1);
       }
-      if (!ncontent) vcov.push_back(lcov);
     }
-    // Drop lowest and highest 25%
+
+    // A count of the region exceeded these counters, the region is parsed again with 32-bit counters
+    inline bool
+    widen() const {
+      return ((saturated) && (sizeof(TValue) < sizeof(uint32_t)));
+    }
+  };
+
+  // Regions given by --region or --bed instead of whole chromosomes
+  template<typename TConfig>
+  inline bool
+  targetedRun(TConfig const& c) {
+    return ((!c.region.empty()) || (!c.bedfile.empty()));
+  }
+
+  template<typename TNMask, typename TCumVector>
+  inline void
+  covParams(TNMask const& nrun, TCumVector const& cumcov, uint32_t const seedwin, bool const targeted, uint32_t const exStart, uint32_t const exEnd, uint32_t& avgcov, uint32_t& sdcov) {
+    // Collect coverage values, windows overlapping [exStart, exEnd) are skipped unless the flanks have too few
+    std::vector<uint32_t> vcov;
+    for(uint32_t i = seedwin; i < cumcov.size() - 1; i = i + seedwin) {
+      if ((i > exStart) && (i - seedwin < exEnd)) continue;
+      if (!nrun.any(i - seedwin, i)) vcov.push_back(cumcov[i] - cumcov[i - seedwin]);
+    }
+    if ((exStart < exEnd) && (vcov.size() < 4)) {
+      covParams(nrun, cumcov, seedwin, targeted, 0, 0, avgcov, sdcov);
+      return;
+    }
+    // Drop lowest and highest 25%, always for targeted regions that may be dominated by the amplicon itself
     uint32_t ist = 0;
     uint32_t ien = vcov.size();
-    if (ien > 1000) {
+    if ((ien > 1000) || ((targeted) && (ien >= 4))) {
       ist = (uint32_t) (0.25 * vcov.size());
       ien = (uint32_t) (0.75 * vcov.size());
       std::sort(vcov.begin(), vcov.end());
@@ -170,230 +391,245 @@ namespace rayas
     avgcov = boost::accumulators::mean(acc);
   }
 
-  template<typename TBitSet, typename TVector, typename TValue>
+  template<typename TSegments>
+  inline bool
+  findSegment(TSegments const& sgm, uint32_t const pos, uint32_t& id) {
+    // Segments of a chromosome are sorted and non-overlapping, find the last segment starting at or before pos
+    uint32_t lo = 0;
+    uint32_t hi = sgm.size();
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (sgm[mid].start <= pos) lo = mid + 1;
+      else hi = mid;
+    }
+    if ((lo > 0) && (pos <= sgm[lo - 1].end)) {
+      id = lo - 1;
+      return true;
+    }
+    return false;
+  }
+
+  template<typename TNMask, typename TCumVector, typename TValue>
   inline bool
-  getcov(TBitSet const& nrun, TVector const& cov, uint32_t const start, uint32_t const end, TValue& lcov) {
-    lcov = 0;
-    for(uint32_t k = start; k < end; ++k) {
-      if (nrun[k]) return false;
-      lcov += cov[k];
+  getcov(TNMask const& nrun, TCumVector const& cumcov, uint32_t const start, uint32_t const end, TValue& lcov) {
+    if (nrun.any(start, end)) {
+      lcov = 0;
+      return false;
     }
+    lcov = (typename TCumVector::value_type) (cumcov[end] - cumcov[start]);
     return true;
   }
   
 
-  template<typename TReadSegment, typename TEdgeSupport>
+  inline uint64_t
+  edgeKey(uint32_t const id1, uint32_t const id2) {
+    return (((uint64_t) id1) << 32) | ((uint64_t) id2);
+  }
+
+  inline uint32_t
+  edgeSource(uint64_t const key) {
+    return (uint32_t) (key >> 32);
+  }
+
+  inline uint32_t
+  edgeTarget(uint64_t const key) {
+    return (uint32_t) (key & 0xFFFFFFFF);
+  }
+
+  template<typename TSorter, typename TEdgeSupport>
   inline void
-  computelinks(TReadSegment const& read, TEdgeSupport& es) {
-    std::size_t oldid = 0;
-    int32_t kleft = 0;
-    for(uint32_t k = 0; k < read.size(); ++k) {
-      if (read[k].first == oldid) {
-	for(int32_t walk = k - 1; walk >= kleft; --walk) {
-	  uint32_t id1 = read[k].second;
-	  uint32_t id2 = read[walk].second;
-	  if (id1 > id2) {
-	    uint32_t tmp = id1;
-	    id1 = id2;
-	    id2 = tmp;
-	  }
-	  if (es.find(std::make_pair(id1, id2)) == es.end()) es.insert(std::make_pair(std::make_pair(id1, id2), 1));
-	  else ++es[std::make_pair(id1, id2)];
+  computelinks(TSorter& sorter, std::vector<uint32_t> const& regionOffset, TEdgeSupport& es) {
+    // Records are streamed sorted by read seed, all segments of one split-read are pairwise linked
+    ReadId oldid;
+    std::vector<uint32_t> group;
+    typename TSorter::value_type rec;
+    while (sorter.next(rec)) {
+      uint32_t sid = regionOffset[rec.region] + rec.segment;
+      if ((!group.empty()) && (rec.id == oldid)) {
+	for(uint32_t walk = 0; walk < group.size(); ++walk) {
+	  uint32_t id1 = std::min(sid, group[walk]);
+	  uint32_t id2 = std::max(sid, group[walk]);
+	  ++es[edgeKey(id1, id2)];
 	}
       } else {
 	// New split-read
-	oldid = read[k].first;
-	kleft = k;
+	oldid = rec.id;
+	group.clear();
       }
+      group.push_back(sid);
     }
   }
   
-  template<typename TConfig, typename TEdgeSupport, typename TSegments>
+  inline uint32_t
+  findRoot(std::vector<uint32_t>& parent, uint32_t id) {
+    // Path halving
+    while (parent[id] != id) {
+      parent[id] = parent[parent[id]];
+      id = parent[id];
+    }
+    return id;
+  }
+
+  template<typename TConfig, typename TEdgeList, typename TSegments>
   inline void
-  segconnect(TConfig const& c, TEdgeSupport& es, TSegments& sgm) {
-    // Segments are nodes, split-reads are edges
-    for(uint32_t id1 = 0; id1 < sgm.size(); ++id1) {
-      for(uint32_t id2 = id1 + 1; id2 < sgm.size(); ++id2) {
-	if (es.find(std::make_pair(id1, id2)) != es.end()) {
-	  if (es[std::make_pair(id1, id2)] >= c.minSplit) {
-	    // Vertices in different components?
-	    if (sgm[id1].cid != sgm[id2].cid) {
-	      uint32_t oldid = sgm[id2].cid;
-	      for(uint32_t i = 0; i < sgm.size(); ++i) {
-		if (sgm[i].cid == oldid) sgm[i].cid = sgm[id1].cid;
-	      }
-	    }
-	  }
-	}
-      }
+  segconnect(TConfig const& c, TEdgeList const& edges, TSegments& sgm) {
+    // Segments are nodes, split-reads are edges, union-find by rank
+    std::vector<uint32_t> parent(sgm.size());
+    std::vector<uint32_t> rank(sgm.size(), 0);
+    std::vector<uint32_t> label(sgm.size());
+    for(uint32_t i = 0; i < sgm.size(); ++i) {
+      parent[i] = i;
+      label[i] = sgm[i].cid;
     }
+    // Edges in (id1, id2) order, a merged component keeps the label of id1's component
+    for(typename TEdgeList::const_iterator it = edges.begin(); it != edges.end(); ++it) {
+      if (edgeSource(it->first) == edgeTarget(it->first)) continue;
+      if (it->second < c.minSplit) continue;
+      uint32_t r1 = findRoot(parent, edgeSource(it->first));
+      uint32_t r2 = findRoot(parent, edgeTarget(it->first));
+      if (r1 == r2) continue;
+      uint32_t lbl = label[r1];
+      if (rank[r1] < rank[r2]) std::swap(r1, r2);
+      parent[r2] = r1;
+      if (rank[r1] == rank[r2]) ++rank[r1];
+      label[r1] = lbl;
+    }
+    for(uint32_t i = 0; i < sgm.size(); ++i) sgm[i].cid = label[findRoot(parent, i)];
   }
-  
 
-  
-  template<typename TConfig>
-  inline int32_t
-  runCall(TConfig& c) {
-    
-#ifdef PROFILE
-    ProfilerStart("rayas.prof");
+  template<typename TConfig, typename TClips, typename TCoverage, typename TChrReadPos>
+  inline void
+  parsePair(TConfig& c, samFile* samfile, hts_idx_t* idx, samFile* cfile, hts_idx_t* cidx, int32_t refIndex, uint32_t const wstart, uint32_t const wend, TClips& left, TClips& right, TCoverage& cov, TClips& cleft, TClips& cright, TCoverage& ccov, TChrReadPos& r1, TChrReadPos& r2, ParseStats& tps, ParseStats& cps) {
+    // Parse tumor and control concurrently (serial if chromosomes are already processed in parallel)
+#pragma omp parallel sections num_threads(2)
+    {
+#pragma omp section
+      {
+	parseChr(c, samfile, idx, refIndex, wstart, wend, left, right, cov, r1, r2, true, tps);
+#ifdef OPENMP
+	tps.offThread = (omp_get_thread_num() != 0);
 #endif
+      }
+#pragma omp section
+      {
+	TChrReadPos cr1;
+	TChrReadPos cr2;
+	parseChr(c, cfile, cidx, refIndex, wstart, wend, cleft, cright, ccov, cr1, cr2, false, cps);
+#ifdef OPENMP
+	cps.offThread = (omp_get_thread_num() != 0);
+#endif
+      }
+    }
+  }
 
-    // Open file handles
-    samFile* samfile = sam_open(c.tumor.string().c_str(), "r");
-    hts_set_fai_filename(samfile, c.genome.string().c_str());
-    hts_idx_t* idx = sam_index_load(samfile, c.tumor.string().c_str());
-    bam_hdr_t* hdr = sam_hdr_read(samfile);
-    samFile* cfile = sam_open(c.control.string().c_str(), "r");
-    hts_set_fai_filename(cfile, c.genome.string().c_str());
-    hts_idx_t* cidx = sam_index_load(cfile, c.control.string().c_str());
-    faidx_t* fai = fai_load(c.genome.string().c_str());
-    char* seq = NULL;
-    
-    // Parse genome, process chromosome by chromosome
-    typedef std::vector<Segment> TSegments;
-    TSegments sgm;
-    typedef std::pair<std::size_t, uint32_t> TReadPos;
-    typedef std::vector<TReadPos> TChrReadPos;
-    TChrReadPos readSeg1;
-    TChrReadPos readSeg2;
-    for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
-      // Any data?
-      if ((!mappedReads(idx, refIndex, c.tumor.string())) || (!mappedReads(idx, refIndex, c.control.string()))) continue;
-
-      // Large enough chromosome?
-      if (hdr->target_len[refIndex] > c.minChrLen) {
-	boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();	  
-	std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Parsing " << hdr->target_name[refIndex] << std::endl;
-      } else continue;
-
-      // Tumor
-      std::vector<uint16_t> left(hdr->target_len[refIndex], 0);
-      std::vector<uint16_t> right(hdr->target_len[refIndex], 0);
-      std::vector<uint16_t> cov(hdr->target_len[refIndex], 0);
-      TChrReadPos r1;
-      TChrReadPos r2;
-      parseChr(c, samfile, idx, hdr, refIndex, left, right, cov, r1, r2, true);
-      
-      // Control
-      std::vector<uint16_t> cleft(hdr->target_len[refIndex], 0);
-      std::vector<uint16_t> cright(hdr->target_len[refIndex], 0);
-      std::vector<uint16_t> ccov(hdr->target_len[refIndex], 0);
-      parseChr(c, cfile, cidx, hdr, refIndex, cleft, cright, ccov, r1, r2, false);
-
-      // Load sequence
-      int32_t seqlen = -1;
-      seq = faidx_fetch_seq(fai, hdr->target_name[refIndex], 0, hdr->target_len[refIndex], &seqlen);
-      typedef boost::dynamic_bitset<> TBitSet;
-      TBitSet nrun(hdr->target_len[refIndex], 0);
-      for(uint32_t i = 0; i < hdr->target_len[refIndex]; ++i) {
-	if ((seq[i] == 'n') || (seq[i] == 'N')) nrun[i] = 1;
+  template<typename TConfig, typename TClips, typename TCumVector, typename TSegments, typename TValue, typename TChrReadPos>
+  inline void
+  findSegments(TConfig& c, int32_t refIndex, uint32_t const offset, uint32_t const len, TClips const& left, TClips const& right, TCumVector const& cumcov, TClips const& cleft, TClips const& cright, TCumVector const& ccumcov, RegionArena<TValue, TChrReadPos>& ar, uint32_t const slot, TSegments& sgm, TChrReadPos& readSeg1, TChrReadPos& readSeg2, RegionStats& rs) {
+    NMask const& nrun = ar.nrun;
+    ControlParams& cp = ar.cp;
+    TChrReadPos const& r1 = ar.r1[slot];
+    TChrReadPos const& r2 = ar.r2[slot];
+    uint32_t seedwin = 2 * c.minSegmentSize;
+    Stopwatch sw;
+    if (2 * seedwin < len) {
+      // Get background coverage, for targeted regions from the flanks only
+      bool targeted = targetedRun(c);
+      uint32_t exStart = targeted ? ar.rstart - offset : 0;
+      uint32_t exEnd = targeted ? ar.rend - offset : 0;
+      uint32_t sdcov = 0;
+      uint32_t avgcov = 0;
+      covParams(nrun, cumcov, seedwin, targeted, exStart, exEnd, avgcov, sdcov);
+      //std::cout << "Tumor avg. coverage and SD coverage " << avgcov << "," << sdcov << std::endl;
+      if (!cp.valid) {
+	covParams(nrun, ccumcov, seedwin, targeted, exStart, exEnd, cp.avgcov, cp.sdcov);
+	cp.valid = true;
       }
-      if (seq != NULL) free(seq);
+      uint32_t csdcov = cp.sdcov;
+      uint32_t cavgcov = cp.avgcov;
+      //std::cout << "Control avg. coverage and SD coverage " << cavgcov << "," << csdcov << std::endl;
+      float expratio = (float) (avgcov) / (float) (cavgcov);
+      rs.covparams += sw.lap();
 
-      uint32_t seedwin = 2 * c.minSegmentSize;
-      std::map<uint32_t, uint32_t> possegmentmap;
-      if (2 * seedwin < hdr->target_len[refIndex]) {
-	// Get background coverage
-	uint32_t sdcov = 0;
-	uint32_t avgcov = 0;
-	covParams(nrun, cov, seedwin, avgcov, sdcov);
-	//std::cout << "Tumor avg. coverage and SD coverage " << avgcov << "," << sdcov << std::endl;
-	uint32_t csdcov = 0;
-	uint32_t cavgcov = 0;
-	covParams(nrun, ccov, seedwin, cavgcov, csdcov);
-	//std::cout << "Control avg. coverage and SD coverage " << cavgcov << "," << csdcov << std::endl;
-	float expratio = (float) (avgcov) / (float) (cavgcov);
-
-	// Identify candidate breakpoints
-	typedef std::vector<Breakpoint> TBreakpointVector;
-	TBreakpointVector bpvec;
-	for(uint32_t i = seedwin; i < hdr->target_len[refIndex] - seedwin; ++i) {
-	  // Left soft-clips
-	  if (left[i] >= c.minSplit) {
-	    uint32_t threshold = (uint32_t) (c.contam * left[i]);
-	    if (cleft[i] <= threshold) {
-	      uint32_t lcov = 0;
-	      uint32_t rcov = 0;
-	      if (!getcov(nrun, cov, i - seedwin, i, lcov)) continue;
-	      if (!getcov(nrun, cov, i, i+seedwin, rcov)) continue;
-	      if ((lcov * (c.sdthres / 2) < rcov) && (rcov > avgcov + c.sdthres * sdcov)) {
-		uint32_t controllcov = 0;
-		uint32_t controlrcov = 0;
-		if (!getcov(nrun, ccov, i - seedwin, i, controllcov)) continue;
-		if (!getcov(nrun, ccov, i, i+seedwin, controlrcov)) continue;
-		if ((controllcov * (c.sdthres / 2) < controlrcov) || (controlrcov > cavgcov + c.sdthres * csdcov)) continue;
-		if (controlrcov > 0) {
-		  float obsratio = rcov / controlrcov;
-		  if (obsratio / expratio > (c.sdthres / 2)) bpvec.push_back(Breakpoint(true, i, left[i], obsratio / expratio));
-		}
-	      }
-	    }
+      // Identify candidate breakpoints
+      std::vector<Breakpoint>& bpvec = ar.bpvec;
+      std::vector<uint32_t>& cand = ar.cand;
+      bpvec.clear();
+      cand.clear();
+      // Breakpoints only within the region
+      uint32_t scanStart = std::max(seedwin, ar.rstart - offset);
+      uint32_t scanEnd = std::min(len - seedwin, ar.rend - offset);
+      clipCandidates(left, right, cleft, cright, c.minSplit, c.contam, scanStart, scanEnd, cand);
+      rs.candidates += cand.size();
+      for(uint32_t ci = 0; ci < cand.size(); ++ci) {
+	// Left and right soft-clips are evaluated together, the coverage windows on either side are looked up once
+	uint32_t i = cand[ci];
+	bool lclip = clipPass(left[i], cleft[i], c.minSplit, c.contam);
+	bool rclip = clipPass(right[i], cright[i], c.minSplit, c.contam);
+	uint32_t lcov = 0;
+	uint32_t rcov = 0;
+	if (!getcov(nrun, cumcov, i - seedwin, i, lcov)) continue;
+	if (!getcov(nrun, cumcov, i, i+seedwin, rcov)) continue;
+	bool lbp = ((lclip) && (lcov * (c.sdthres / 2) < rcov) && (rcov > avgcov + c.sdthres * sdcov));
+	bool rbp = ((rclip) && (rcov * (c.sdthres / 2) < lcov) && (lcov > avgcov + c.sdthres * sdcov));
+	if ((!lbp) && (!rbp)) continue;
+	uint32_t controllcov = 0;
+	uint32_t controlrcov = 0;
+	if (!getcov(nrun, ccumcov, i - seedwin, i, controllcov)) continue;
+	if (!getcov(nrun, ccumcov, i, i+seedwin, controlrcov)) continue;
+	// A left breakpoint rejected by the control coverage also drops the right clips at this position
+	if (lbp) {
+	  if ((controllcov * (c.sdthres / 2) < controlrcov) || (controlrcov > cavgcov + c.sdthres * csdcov)) continue;
+	  if (controlrcov > 0) {
+	    float obsratio = rcov / controlrcov;
+	    if (obsratio / expratio > (c.sdthres / 2)) bpvec.push_back(Breakpoint(true, i, left[i], obsratio / expratio));
 	  }
-	  // Right soft-clips
-	  if (right[i] >= c.minSplit) {
-	    uint32_t threshold = (uint32_t) (c.contam * right[i]);
-	    if (cright[i] <= threshold) {
-	      uint32_t lcov = 0;
-	      uint32_t rcov = 0;
-	      if (!getcov(nrun, cov, i - seedwin, i, lcov)) continue;
-	      if (!getcov(nrun, cov, i, i+seedwin, rcov)) continue;
-	      if ((rcov * (c.sdthres / 2) < lcov) && (lcov > avgcov + c.sdthres * sdcov)) {
-		uint32_t controllcov = 0;
-		uint32_t controlrcov = 0;
-		if (!getcov(nrun, ccov, i - seedwin, i, controllcov)) continue;
-		if (!getcov(nrun, ccov, i, i+seedwin, controlrcov)) continue;
-		if ((controlrcov * (c.sdthres / 2) < controllcov) || (controllcov > cavgcov + c.sdthres * csdcov)) continue;
-		if (controllcov > 0) {
-		  float obsratio = lcov / controllcov;
-		  if (obsratio / expratio > (c.sdthres / 2)) bpvec.push_back(Breakpoint(false, i, right[i], obsratio / expratio));
-		}
-	      }
-	    }
+	}
+	if (rbp) {
+	  if ((controlrcov * (c.sdthres / 2) < controllcov) || (controllcov > cavgcov + c.sdthres * csdcov)) continue;
+	  if (controllcov > 0) {
+	    float obsratio = lcov / controllcov;
+	    if (obsratio / expratio > (c.sdthres / 2)) bpvec.push_back(Breakpoint(false, i, right[i], obsratio / expratio));
 	  }
 	}
-	
-	// Merge left and right breakpoints into candidate regions
-	if (bpvec.size()) {
-	  std::sort(bpvec.begin(), bpvec.end(), SortBreakpoints<Breakpoint>());
-	  uint32_t lastRight = 0;
-	  for(uint32_t i = 0; i < bpvec.size() - 1; ++i) {
-	    if (i < lastRight) continue;
-	    if ((bpvec[i].left) && (!bpvec[i+1].left) && (bpvec[i+1].pos - bpvec[i].pos < c.maxSegmentSize)) {
-	      // Split-read switchpoint (extend if possible)
-	      uint32_t bestLeft = i;
-	      for(int32_t k = i - 1; k >= 0; --k) {
-		if (!bpvec[k].left) break;
-		if (bpvec[i+1].pos - bpvec[k].pos > c.minSegDist) break;
-		if (bpvec[k].obsexp / bpvec[i].obsexp < 0.5) break;
-		bestLeft = k;
-	      }
-	      uint32_t bestRight = i + 1;
-	      for(uint32_t k = i + 2; k < bpvec.size(); ++k) {
-		if (bpvec[k].left) break;
-		if (bpvec[k].pos - bpvec[i].pos > c.minSegDist) break;
-		if (bpvec[k].obsexp / bpvec[i+1].obsexp < 0.5) break;
-		bestRight = k;
-	      }
-	      uint32_t segsize = bpvec[bestRight].pos - bpvec[bestLeft].pos;
-	      if ((segsize > c.minSegmentSize) && (segsize < c.maxSegmentSize)) {
-		// New candidate segment
-		lastRight = bestRight;
-		uint64_t tmrcov = 0;
-		if (getcov(nrun, cov, bpvec[bestLeft].pos, bpvec[bestRight].pos, tmrcov)) {
-		  uint64_t ctrcov = 0;
-		  if (getcov(nrun, ccov, bpvec[bestLeft].pos, bpvec[bestRight].pos, ctrcov)) {
-		    if (ctrcov > 0) {
-		      float obsratio = (float) (tmrcov) / (float) (ctrcov);
-		      float obsexp = obsratio / expratio;
-		      if (obsexp > 1.5) {
-			uint32_t lid = sgm.size();
-			sgm.push_back(Segment(refIndex, bpvec[bestLeft].pos, bpvec[bestRight].pos, lid, obsexp * c.ploidy));
-			for(uint32_t k = bpvec[bestLeft].pos; k <= bpvec[bestRight].pos; ++k) {
-			  // ToDo: Replace with interval tree !!!
-			  possegmentmap.insert(std::make_pair(k, lid)); 
-			}
-		      }
+      }
+      
+      // Merge left and right breakpoints into candidate regions
+      rs.breakpoints += bpvec.size();
+      if (bpvec.size()) {
+	std::sort(bpvec.begin(), bpvec.end(), SortBreakpoints<Breakpoint>());
+	uint32_t lastRight = 0;
+	for(uint32_t i = 0; i < bpvec.size() - 1; ++i) {
+	  if (i < lastRight) continue;
+	  if ((bpvec[i].left) && (!bpvec[i+1].left) && (bpvec[i+1].pos - bpvec[i].pos < c.maxSegmentSize)) {
+	    // Split-read switchpoint (extend if possible)
+	    uint32_t bestLeft = i;
+	    for(int32_t k = i - 1; k >= 0; --k) {
+	      if (!bpvec[k].left) break;
+	      if (bpvec[i+1].pos - bpvec[k].pos > c.minSegDist) break;
+	      if (bpvec[k].obsexp / bpvec[i].obsexp < 0.5) break;
+	      bestLeft = k;
+	    }
+	    uint32_t bestRight = i + 1;
+	    for(uint32_t k = i + 2; k < bpvec.size(); ++k) {
+	      if (bpvec[k].left) break;
+	      if (bpvec[k].pos - bpvec[i].pos > c.minSegDist) break;
+	      if (bpvec[k].obsexp / bpvec[i+1].obsexp < 0.5) break;
+	      bestRight = k;
+	    }
+	    uint32_t segsize = bpvec[bestRight].pos - bpvec[bestLeft].pos;
+	    if ((segsize > c.minSegmentSize) && (segsize < c.maxSegmentSize)) {
+	      // New candidate segment
+	      lastRight = bestRight;
+	      uint64_t tmrcov = 0;
+	      if (getcov(nrun, cumcov, bpvec[bestLeft].pos, bpvec[bestRight].pos, tmrcov)) {
+		uint64_t ctrcov = 0;
+		if (getcov(nrun, ccumcov, bpvec[bestLeft].pos, bpvec[bestRight].pos, ctrcov)) {
+		  if (ctrcov > 0) {
+		    float obsratio = (float) (tmrcov) / (float) (ctrcov);
+		    float obsexp = obsratio / expratio;
+		    if (obsexp > 1.5) {
+		      uint32_t lid = sgm.size();
+		      sgm.push_back(Segment(refIndex, offset + bpvec[bestLeft].pos, offset + bpvec[bestRight].pos, lid, obsexp * c.ploidy));
 		    }
 		  }
 		}
@@ -402,41 +638,512 @@ namespace rayas
 	  }
 	}
       }
-      // Carry-over all split-reads
-      if (!possegmentmap.empty()) {
-	for(uint32_t i = 0; i < r1.size(); ++i) {
-	  if (possegmentmap.find(r1[i].second) != possegmentmap.end()) {
-	    // Keep track of seed and segment
-	    readSeg1.push_back(std::make_pair(r1[i].first, possegmentmap[r1[i].second]));
+    }
+    // Carry-over all split-reads
+    if (!sgm.empty()) {
+      uint32_t lid = 0;
+      for(uint32_t i = 0; i < r1.size(); ++i) {
+	// Keep track of seed and segment
+	if (findSegment(sgm, r1[i].second, lid)) readSeg1.push_back(std::make_pair(r1[i].first, lid));
+      }
+      for(uint32_t i = 0; i < r2.size(); ++i) {
+	// Keep track of seed and segment
+	if (findSegment(sgm, r2[i].second, lid)) readSeg2.push_back(std::make_pair(r2[i].first, lid));
+      }
+    }
+    rs.segments += sgm.size();
+    rs.scan += sw.lap();
+  }
+
+
+  // Parse stage time, CPU time of a helper thread running a parsePair section is added to the region thread's
+  inline StageTime
+  parseTime(Stopwatch& sw, ParseStats const& tps, ParseStats const& cps) {
+    StageTime st = sw.lap();
+    if (tps.offThread) st.cpu += tps.cpu;
+    if (cps.offThread) st.cpu += cps.cpu;
+    return st;
+  }
+
+  // Seed windows on either side of a targeted region that are parsed for the background coverage only
+  static uint32_t const bgFlankWindows = 50;
+
+  // Region plus a seed window margin on either side, targeted regions also get the background flanks
+  template<typename TConfig>
+  inline void
+  regionWindow(TConfig const& c, bam_hdr_t const* hdr, Region const& rg, uint32_t& wstart, uint32_t& wend) {
+    uint32_t seedwin = 2 * c.minSegmentSize;
+    uint32_t margin = seedwin;
+    if (targetedRun(c)) margin += bgFlankWindows * seedwin;
+    wstart = 0;
+    if (rg.start > margin) wstart = rg.start - margin;
+    wend = std::min(rg.end + margin, hdr->target_len[rg.tid]);
+  }
+
+  // Parses tumor t into a slot, the control alongside the first tumor, and builds the cumulative coverage
+  // Returns false if the region is missing from the tracks or the tracks are damaged
+  template<typename TConfig, typename TValue, typename TChrReadPos>
+  inline bool
+  _parseTumor(TConfig& c, uint32_t const t, uint32_t const slot, std::vector<samFile*> const& samfiles, std::vector<hts_idx_t*> const& idxs, samFile* cfile, hts_idx_t* cidx, int32_t const refIndex, TrackHandle const& th, RegionArena<TValue, TChrReadPos>& ar, RegionStats& rs) {
+    typedef typename RegionArena<TValue, TChrReadPos>::TClip TClip;
+    typedef typename RegionArena<TValue, TChrReadPos>::TCoverage TCoverage;
+    Stopwatch sw;
+    uint32_t wstart = ar.wstart;
+    uint32_t wend = ar.wend;
+    uint32_t len = wend - wstart;
+    TChrReadPos& r1 = ar.r1[slot];
+    TChrReadPos& r2 = ar.r2[slot];
+    r1.clear();
+    r2.clear();
+    ParseStats tps;
+    ParseStats none;
+    if (c.compact) {
+      // Sparse clipping counts and block-packed coverage
+      SparseCounts<TClip>& left = ar.sleft[slot];
+      SparseCounts<TClip>& right = ar.sright[slot];
+      CompactCoverage<TCoverage>& cov = ar.scov[slot];
+      left.reset();
+      right.reset();
+      cov.reset(len);
+      if (t == 0) {
+	ar.scleft.reset();
+	ar.scright.reset();
+	ar.sccov.reset(len);
+	parsePair(c, samfiles[t], idxs[t], cfile, cidx, refIndex, wstart, wend, left, right, cov, ar.scleft, ar.scright, ar.sccov, r1, r2, tps, rs.control);
+      }
+      else parseChr(c, samfiles[t], idxs[t], refIndex, wstart, wend, left, right, cov, r1, r2, true, tps);
+    } else {
+      // Tumor
+      std::vector<TClip>& left = ar.left[slot].reset(len);
+      std::vector<TClip>& right = ar.right[slot].reset(len);
+      std::vector<TCoverage>& cov = ar.cov[slot].reset(len);
+      if (t > 0) parseChr(c, samfiles[t], idxs[t], refIndex, wstart, wend, left, right, ar.cov[slot], r1, r2, true, tps);
+      else {
+	// Control
+	std::vector<TClip>& cleft = ar.cleft.reset(len);
+	std::vector<TClip>& cright = ar.cright.reset(len);
+	std::vector<TCoverage>& ccov = ar.ccov.reset(len);
+	if (th.load) {
+	  // Parsed tracks of an earlier run instead of the alignments
+	  TrackIndexEntry e;
+	  if ((th.fp == NULL) || (!th.index->find(refIndex, wstart, wend, e))) return false;
+	  if (e.counters > 8 * sizeof(TClip)) {
+	    // The region saturated these counters when the tracks were written, its record holds wider ones
+	    ar.saturated = true;
+	    return true;
 	  }
-	}
-	for(uint32_t i = 0; i < r2.size(); ++i) {
-	  if (possegmentmap.find(r2[i].second) != possegmentmap.end()) {
-	    // Keep track of seed and segment
-	    readSeg2.push_back(std::make_pair(r2[i].first, possegmentmap[r2[i].second]));
+	  if ((e.counters != 8 * sizeof(TClip)) || (!readTrackRecord(th.fp, e, wstart, wend, left, right, cov, cleft, cright, ccov, r1, r2, tps, rs.control))) return false;
+	} else {
+	  parsePair(c, samfiles[t], idxs[t], cfile, cidx, refIndex, wstart, wend, left, right, ar.cov[slot], cleft, cright, ar.ccov, r1, r2, tps, rs.control);
+	  // A saturated region is only written once it was parsed again with wider counters
+	  if ((tps.saturated) || (rs.control.saturated)) ar.saturated = true;
+	  if ((th.dump) && (!ar.widen())) {
+#pragma omp critical(tracks)
+	    {
+	      // The dump is abandoned after the first failed record
+	      if ((!*th.failed) && (!writeTrackRecord(th.fp, *th.index, refIndex, wstart, wend, left, right, cov, cleft, cright, ccov, r1, r2, tps, rs.control))) *th.failed = true;
+	    }
 	  }
 	}
+	ar.cleft.touched(rs.control.spanStart, rs.control.spanEnd);
+	ar.cright.touched(rs.control.spanStart, rs.control.spanEnd);
+	ar.ccov.touched(rs.control.spanStart, rs.control.spanEnd);
+	prefixSum(ar.ccov, ar.ccumcov);
+      }
+      ar.left[slot].touched(tps.spanStart, tps.spanEnd);
+      ar.right[slot].touched(tps.spanStart, tps.spanEnd);
+      ar.cov[slot].touched(tps.spanStart, tps.spanEnd);
+
+      // Cumulative coverage, window sums become two lookups
+      prefixSum(ar.cov[slot], ar.cumcov[slot]);
+    }
+    if ((tps.saturated) || ((t == 0) && (rs.control.saturated))) ar.saturated = true;
+    rs.tumor += tps;
+    rs.parse += parseTime(sw, tps, (t == 0) ? rs.control : none);
+    return true;
+  }
+
+  template<typename TConfig, typename TSegments, typename TValue, typename TChrReadPos>
+  inline void
+  _scanTumor(TConfig& c, uint32_t const slot, int32_t const refIndex, RegionArena<TValue, TChrReadPos>& ar, TSegments& sgm, TChrReadPos& readSeg1, TChrReadPos& readSeg2, RegionStats& rs) {
+    uint32_t len = ar.wend - ar.wstart;
+    if (c.compact) findSegments(c, refIndex, ar.wstart, len, ar.sleft[slot], ar.sright[slot], ar.scov[slot], ar.scleft, ar.scright, ar.sccov, ar, slot, sgm, readSeg1, readSeg2, rs);
+    else findSegments(c, refIndex, ar.wstart, len, ar.left[slot].data, ar.right[slot].data, ar.cumcov[slot], ar.cleft.data, ar.cright.data, ar.ccumcov, ar, slot, sgm, readSeg1, readSeg2, rs);
+    rs.tracked += ar.r1[slot].size() + ar.r2[slot].size();
+  }
+
+  // Reader stage, window and N-mask of a region and, if ahead, the parsed alignments of all tumors and the control
+  template<typename TConfig, typename TValue, typename TChrReadPos>
+  inline bool
+  loadRegion(TConfig& c, std::vector<samFile*> const& samfiles, std::vector<hts_idx_t*> const& idxs, samFile* cfile, hts_idx_t* cidx, faidx_t* fai, NRuns const* nruns, bam_hdr_t* hdr, Region const& rg, TrackHandle const& th, RegionArena<TValue, TChrReadPos>& ar, bool const ahead, RegionStats& rs) {
+    int32_t refIndex = rg.tid;
+    Stopwatch sw;
+    regionWindow(c, hdr, rg, ar.wstart, ar.wend);
+    ar.rstart = rg.start;
+    ar.rend = rg.end;
+    uint32_t wstart = ar.wstart;
+    uint32_t wend = ar.wend;
+    uint32_t len = wend - wstart;
+
+    // N-mask from precomputed N-runs or the sequence
+    NMask& nrun = ar.nrun;
+    nrun.reset(len);
+    if (nruns != NULL) {
+      NRuns::TIntervals iv;
+      nruns->overlapping(hdr->target_name[refIndex], wstart, wend, iv);
+      for(uint32_t i = 0; i < iv.size(); ++i) nrun.set(iv[i].first, iv[i].second);
+    } else {
+      int32_t seqlen = -1;
+      char* seq = faidx_fetch_seq(fai, hdr->target_name[refIndex], wstart, wend - 1, &seqlen);
+      for(uint32_t i = 0; i < len; ++i) {
+	if ((seq[i] == 'n') || (seq[i] == 'N')) nrun.set(i);
       }
+      if (seq != NULL) free(seq);
+    }
+    nrun.build();
+    ar.cp = ControlParams();
+    ar.saturated = false;
+    rs.parse += sw.lap();
+    if (ahead) {
+      for(uint32_t t = 0; (t < samfiles.size()) && (!ar.widen()); ++t) {
+	if (!_parseTumor(c, t, t, samfiles, idxs, cfile, cidx, refIndex, th, ar, rs)) return false;
+      }
+    }
+    return true;
+  }
+
+  // Analysis stage, breakpoints and segments of all tumors, tumors not loaded ahead are parsed in turn into a shared slot
+  // Segment ids are local to this region, runCall offsets them when merging, nothing is scanned once a count saturated
+  template<typename TConfig, typename TSegments, typename TValue, typename TChrReadPos>
+  inline bool
+  analyseRegion(TConfig& c, std::vector<samFile*> const& samfiles, std::vector<hts_idx_t*> const& idxs, samFile* cfile, hts_idx_t* cidx, Region const& rg, TrackHandle const& th, RegionArena<TValue, TChrReadPos>& ar, bool const ahead, std::vector<TSegments>& sgm, std::vector<TChrReadPos>& readSeg1, std::vector<TChrReadPos>& readSeg2, RegionStats& rs) {
+    for(uint32_t t = 0; t < samfiles.size(); ++t) {
+      uint32_t slot = ahead ? t : 0;
+      if ((!ahead) && (!_parseTumor(c, t, slot, samfiles, idxs, cfile, cidx, rg.tid, th, ar, rs))) return false;
+      if (ar.widen()) break;
+      _scanTumor(c, slot, rg.tid, ar, sgm[t], readSeg1[t], readSeg2[t], rs);
+    }
+    rs.peakRSS = peakRSS();
+    return true;
+  }
+
+  // Region on its way from the reader to the analysis stage
+  template<typename TSegments, typename TChrReadPos>
+  struct RegionJob {
+    bool restored;
+    bool loaded;
+    bool widen;  // Counters saturated, the region still needs to be parsed with 32-bit counters
+    std::string chrName;
+    boost::filesystem::path ckpt;
+    std::vector<TSegments> sgm;
+    std::vector<TChrReadPos> readSeg1;
+    std::vector<TChrReadPos> readSeg2;
+
+    RegionJob(uint32_t const nt) : restored(false), loaded(false), widen(false), sgm(nt), readSeg1(nt), readSeg2(nt) {}
+  };
+
+  // Restores a region from its checkpoint or loads it
+  template<typename TConfig, typename TSegments, typename TValue, typename TChrReadPos>
+  inline void
+  startRegion(TConfig& c, uint64_t const fingerprint, std::vector<samFile*> const& samfiles, std::vector<hts_idx_t*> const& idxs, samFile* cfile, hts_idx_t* cidx, faidx_t* fai, NRuns const* nruns, bam_hdr_t* hdr, Region const& rg, TrackHandle const& th, RegionArena<TValue, TChrReadPos>& ar, bool const ahead, RegionJob<TSegments, TChrReadPos>& job, RegionStats& rs) {
+#pragma omp critical
+    {
+      boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();	  
+      std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Parsing " << hdr->target_name[rg.tid];
+      if ((rg.start > 0) || (rg.end < hdr->target_len[rg.tid])) std::cout << ':' << rg.start + 1 << '-' << rg.end;
+      std::cout << std::endl;
+    }
+    rs.tid = rg.tid;
+    rs.start = rg.start;
+    rs.end = rg.end;
+    job.chrName = hdr->target_name[rg.tid];
+    if (!c.checkpointDir.empty()) job.ckpt = checkpointPath(c.checkpointDir, job.chrName, rg.start, rg.end, hdr->target_len[rg.tid]);
+    if ((!job.ckpt.empty()) && (readCheckpoint(job.ckpt, fingerprint, rg.tid, job.chrName, rg.start, rg.end, job.sgm[0], job.readSeg1[0], job.readSeg2[0]))) {
+#pragma omp critical
+      {
+	std::cout << "Restored " << job.sgm[0].size() << " segments from checkpoint " << job.ckpt.string() << std::endl;
+      }
+      job.restored = true;
+      rs.restored = true;
+      rs.segments = job.sgm[0].size();
+    }
+    else job.loaded = loadRegion(c, samfiles, idxs, cfile, cidx, fai, nruns, hdr, rg, th, ar, ahead, rs);
+  }
+
+  // Analyses a loaded region, writes its checkpoint and hands its segments and split-reads to the partial file or the linking step
+  // A region whose counts saturated is only marked for widenRegion
+  template<typename TConfig, typename TSegments, typename TValue, typename TChrReadPos, typename TSorter>
+  inline void
+  finishRegion(TConfig& c, uint64_t const fingerprint, std::vector<samFile*> const& samfiles, std::vector<hts_idx_t*> const& idxs, samFile* cfile, hts_idx_t* cidx, int32_t const ri, Region const& rg, TrackHandle const& th, RegionArena<TValue, TChrReadPos>& ar, bool const ahead, RegionJob<TSegments, TChrReadPos>& job, RegionStats& rs, std::ofstream& partial, std::vector<std::vector<TSegments> >& regionSgm, boost::ptr_vector<TSorter>& splitReads1, boost::ptr_vector<TSorter>& splitReads2, bool& trackError) {
+    if (!job.restored) {
+      if ((!job.loaded) || (!analyseRegion(c, samfiles, idxs, cfile, cidx, rg, th, ar, ahead, job.sgm, job.readSeg1, job.readSeg2, rs))) {
+#pragma omp critical
+	{
+	  std::cerr << "Error: Region " << job.chrName << ':' << rg.start + 1 << '-' << rg.end << " is missing from track file " << c.tracks.string() << std::endl;
+	  trackError = true;
+	}
+	return;
+      }
+      if (ar.widen()) {
+	job.widen = true;
+	return;
+      }
+      rs.counters = 8 * sizeof(typename RegionArena<TValue, TChrReadPos>::TClip);
+      if ((!job.ckpt.empty()) && (!writeCheckpoint(job.ckpt, fingerprint, c.minSplit, c.minSegDist, rg.tid, job.chrName, rg.start, rg.end, job.sgm[0], job.readSeg1[0], job.readSeg2[0]))) {
+#pragma omp critical
+	{
+	  std::cerr << "Warning: Checkpoint " << job.ckpt.string() << " could not be written" << std::endl;
+	}
+      }
+    }
+    if (partial.is_open()) {
+#pragma omp critical(splitreads)
+      {
+	writeRecord(partial, fingerprint, c.minSplit, c.minSegDist, rg.tid, job.chrName, rg.start, rg.end, job.sgm[0], job.readSeg1[0], job.readSeg2[0]);
+      }
+      return;
+    }
+#pragma omp critical(splitreads)
+    {
+      for(uint32_t t = 0; t < job.sgm.size(); ++t) {
+	regionSgm[t][ri].swap(job.sgm[t]);
+	for(uint32_t i = 0; i < job.readSeg1[t].size(); ++i) splitReads1[t].push(SplitRead(job.readSeg1[t][i].first, ri, job.readSeg1[t][i].second));
+	for(uint32_t i = 0; i < job.readSeg2[t].size(); ++i) splitReads2[t].push(SplitRead(job.readSeg2[t][i].first, ri, job.readSeg2[t][i].second));
+      }
+    }
+  }
+
+  // Index of an alignment file, the file itself is closed again
+  // Parses and analyses a region again with 32-bit counters after a narrower count saturated, the counts of the first pass are dropped
+  // Runs outside of the pipelined sections, the file handles of the worker are not in use
+  template<typename TConfig, typename TSegments, typename TChrReadPos, typename TSorter>
+  inline void
+  widenRegion(TConfig& c, uint64_t const fingerprint, std::vector<samFile*> const& samfiles, std::vector<hts_idx_t*> const& idxs, samFile* cfile, hts_idx_t* cidx, faidx_t* fai, NRuns const* nruns, bam_hdr_t* hdr, int32_t const ri, Region const& rg, TrackHandle const& th, uint32_t const maxlen, boost::ptr_vector<RegionArena<uint32_t, TChrReadPos> >& wide, RegionJob<TSegments, TChrReadPos>& job, RegionStats& rs, std::ofstream& partial, std::vector<std::vector<TSegments> >& regionSgm, boost::ptr_vector<TSorter>& splitReads1, boost::ptr_vector<TSorter>& splitReads2, bool& trackError) {
+    if (!job.widen) return;
+#pragma omp critical
+    {
+      std::cout << "Counts in " << job.chrName << ':' << rg.start + 1 << '-' << rg.end << " saturated, parsing again with 32-bit counters" << std::endl;
+    }
+    if (wide.empty()) wide.push_back(new RegionArena<uint32_t, TChrReadPos>(maxlen, !c.compact, 1));
+    RegionJob<TSegments, TChrReadPos> wjob(job.sgm.size());
+    wjob.chrName = job.chrName;
+    wjob.ckpt = job.ckpt;
+    rs.tumor = ParseStats();
+    rs.control = ParseStats();
+    rs.tracked = 0;
+    rs.candidates = 0;
+    rs.breakpoints = 0;
+    rs.segments = 0;
+    wjob.loaded = loadRegion(c, samfiles, idxs, cfile, cidx, fai, nruns, hdr, rg, th, wide[0], false, rs);
+    finishRegion(c, fingerprint, samfiles, idxs, cfile, cidx, ri, rg, th, wide[0], false, wjob, rs, partial, regionSgm, splitReads1, splitReads2, trackError);
+  }
+
+  template<typename TConfig>
+  inline hts_idx_t*
+  loadIndex(TConfig const& c, boost::filesystem::path const& path) {
+    samFile* fp = sam_open(path.string().c_str(), "r");
+    if (fp == NULL) return NULL;
+    hts_set_fai_filename(fp, c.genome.string().c_str());
+    hts_idx_t* idx = sam_index_load(fp, path.string().c_str());
+    sam_close(fp);
+    return idx;
+  }
+
+  template<typename TConfig>
+  inline bool
+  parseRegions(TConfig const& c, bam_hdr_t* hdr, std::vector<hts_idx_t*> const& idxs, hts_idx_t* cidx, std::vector<Region>& regions) {
+    // Single chromosome, the same filters apply so that all partial runs together match a whole-genome run
+    int32_t chrIndex = -1;
+    if (!c.chr.empty()) {
+      chrIndex = bam_name2id(hdr, c.chr.c_str());
+      if (chrIndex < 0) {
+	std::cerr << "Error: Unknown chromosome " << c.chr << std::endl;
+	return false;
+      }
+    }
+    if ((c.region.empty()) && (c.bedfile.empty())) {
+      // Whole chromosomes
+      for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
+	if ((chrIndex >= 0) && (refIndex != chrIndex)) continue;
+	// Any data in the control and in at least one tumor?
+	bool tumorReads = false;
+	for(uint32_t t = 0; (!tumorReads) && (t < idxs.size()); ++t) tumorReads = mappedReads(idxs[t], refIndex, c.tumors[t].string());
+	if ((!tumorReads) || (!mappedReads(cidx, refIndex, c.control.string()))) continue;
+	// Large enough chromosome?
+	if (hdr->target_len[refIndex] <= c.minChrLen) continue;
+	regions.push_back(Region(refIndex, 0, hdr->target_len[refIndex]));
+      }
+      return true;
+    }
+
+    // Contig lookup
+    std::map<std::string, int32_t> tidmap;
+    for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) tidmap[hdr->target_name[refIndex]] = refIndex;
+
+    // Explicit regions, chr:start-end is 1-based and inclusive, BED is 0-based and half-open
+    std::vector<Region> rgs;
+    if (!c.region.empty()) {
+      std::size_t colon = c.region.find_last_of(':');
+      std::string chrName = c.region.substr(0, colon);
+      if (tidmap.find(chrName) == tidmap.end()) {
+	std::cerr << "Error: Unknown chromosome " << chrName << std::endl;
+	return false;
+      }
+      int32_t refIndex = tidmap[chrName];
+      uint32_t start = 0;
+      uint32_t end = hdr->target_len[refIndex];
+      if (colon != std::string::npos) {
+	std::vector<std::string> pos;
+	std::string range = c.region.substr(colon + 1);
+	boost::erase_all(range, ",");
+	boost::split(pos, range, boost::is_any_of("-"));
+	try {
+	  start = boost::lexical_cast<uint32_t>(pos[0]);
+	  if (pos.size() > 1) end = boost::lexical_cast<uint32_t>(pos[1]);
+	} catch (boost::bad_lexical_cast const&) {
+	  std::cerr << "Error: Region " << c.region << " is not of the form chr:start-end" << std::endl;
+	  return false;
+	}
+	if ((start < 1) || (end > hdr->target_len[refIndex])) {
+	  std::cerr << "Error: Region " << c.region << " is outside of " << chrName << ":1-" << hdr->target_len[refIndex] << std::endl;
+	  return false;
+	}
+	if (start > end) {
+	  std::cerr << "Error: Region " << c.region << " has start > end" << std::endl;
+	  return false;
+	}
+	--start;
+      }
+      rgs.push_back(Region(refIndex, start, end));
+    }
+    if (!c.bedfile.empty()) {
+      std::ifstream bedFile(c.bedfile.string().c_str(), std::ifstream::in);
+      if (!bedFile.is_open()) {
+	std::cerr << "Error: BED file " << c.bedfile.string() << " cannot be opened" << std::endl;
+	return false;
+      }
+      std::string line;
+      while (std::getline(bedFile, line)) {
+	if ((line.empty()) || (line[0] == '#') || (line.compare(0, 5, "track") == 0) || (line.compare(0, 7, "browser") == 0)) continue;
+	std::vector<std::string> fields;
+	boost::split(fields, line, boost::is_any_of("\t "), boost::token_compress_on);
+	if (fields.size() < 3) continue;
+	if (tidmap.find(fields[0]) == tidmap.end()) {
+	  std::cerr << "Warning: Skipping BED interval on unknown chromosome " << fields[0] << std::endl;
+	  continue;
+	}
+	try {
+	  rgs.push_back(Region(tidmap[fields[0]], boost::lexical_cast<uint32_t>(fields[1]), boost::lexical_cast<uint32_t>(fields[2])));
+	} catch (boost::bad_lexical_cast const&) {
+	  std::cerr << "Error: Malformed BED line " << line << std::endl;
+	  return false;
+	}
+      }
+      bedFile.close();
+    }
+
+    // Clamp, sort and merge regions whose seed windows would overlap
+    uint32_t seedwin = 2 * c.minSegmentSize;
+    for(uint32_t i = 0; i < rgs.size(); ++i) rgs[i].end = std::min(rgs[i].end, hdr->target_len[rgs[i].tid]);
+    std::sort(rgs.begin(), rgs.end(), SortRegions<Region>());
+    for(uint32_t i = 0; i < rgs.size(); ++i) {
+      if (rgs[i].start >= rgs[i].end) continue;
+      if ((chrIndex >= 0) && (rgs[i].tid != chrIndex)) continue;
+      if ((!regions.empty()) && (regions.back().tid == rgs[i].tid) && (rgs[i].start <= regions.back().end + 2 * seedwin)) regions.back().end = std::max(regions.back().end, rgs[i].end);
+      else regions.push_back(rgs[i]);
+    }
+    return true;
+  }
+
+  // Confirmed segments and their edges as GFA, or as an edge list for any other extension
+  template<typename TConfig, typename TSegments, typename TEdgeList>
+  inline bool
+  writeGraph(TConfig const& c, boost::filesystem::path const& path, std::vector<std::string> const& chrNames, TSegments const& sgm, std::vector<bool> const& confirmed, TEdgeList const& edges, std::vector<uint32_t> const& edgeStart) {
+    OutputWriter out;
+    if (!out.open(path)) return false;
+    bool gfa = (plainPath(path).extension().string() == ".gfa");
+    if (gfa) {
+      // Segments are reference intervals, links carry the split-read support but no orientation
+      out << "H\tVN:Z:1.0";
+      out.endl();
+      for(uint32_t i = 0; i < sgm.size(); ++i) {
+	if (!confirmed[sgm[i].cid]) continue;
+	out << "S\t" << i << "\t*\tLN:i:" << sgm[i].end - sgm[i].start << "\tSN:Z:" << chrNames[sgm[i].refIndex] << "\tSO:i:" << sgm[i].start << "\tcn:f:" << sgm[i].cn << "\tcl:i:" << sgm[i].cid;
+	out.endl();
+      }
+    } else {
+      out << "source\tsourcechr\tsourcestart\tsourceend\ttarget\ttargetchr\ttargetstart\ttargetend\tsupport\tclusterid";
+      out.endl();
+    }
+    for(uint32_t i = 0; i < sgm.size(); ++i) {
+      if (!confirmed[sgm[i].cid]) continue;
+      for(uint32_t k = edgeStart[i]; k < edgeStart[i+1]; ++k) {
+	if (edges[k].second < c.minSplit) continue;
+	uint32_t j = edgeTarget(edges[k].first);
+	if (gfa) out << "L\t" << i << "\t+\t" << j << "\t+\t*\tRC:i:" << edges[k].second;
+	else {
+	  out << i << '\t' << chrNames[sgm[i].refIndex] << '\t' << sgm[i].start << '\t' << sgm[i].end << '\t';
+	  out << j << '\t' << chrNames[sgm[j].refIndex] << '\t' << sgm[j].start << '\t' << sgm[j].end << '\t';
+	  out << edges[k].second << '\t' << sgm[i].cid;
+	}
+	out.endl();
+      }
+    }
+    return out.close();
+  }
+
+  // Links segments of all regions through shared split-reads, computes components and writes the confirmed ones
+  // Returns false if the output could not be written
+  template<typename TConfig, typename TSegments, typename TSorter>
+  inline bool
+  linkSegments(TConfig const& c, std::vector<std::string> const& chrNames, std::vector<TSegments>& regionSgm, TSorter& splitReads1, TSorter& splitReads2, boost::filesystem::path const& outfile, boost::filesystem::path const& graphfile, CallStats& st) {
+    // Merge regions, segment ids are assigned in genomic order
+    Stopwatch sw;
+    TSegments sgm;
+    std::vector<uint32_t> regionOffset(regionSgm.size(), 0);
+    for(uint32_t ri = 0; ri < regionSgm.size(); ++ri) {
+      regionOffset[ri] = sgm.size();
+      for(uint32_t i = 0; i < regionSgm[ri].size(); ++i) {
+	sgm.push_back(regionSgm[ri][i]);
+	sgm.back().cid += regionOffset[ri];
+      }
+      TSegments().swap(regionSgm[ri]);
     }
 
     // Compute links
     boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();	  
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Computing segment links" << std::endl;
     // Sort split-reads by read ID
-    std::sort(readSeg1.begin(), readSeg1.end());
-    std::sort(readSeg2.begin(), readSeg2.end());
+    splitReads1.finish();
+    splitReads2.finish();
     
-    // Edges
-    typedef std::pair<uint32_t, uint32_t> TEdge;
-    typedef std::map<TEdge, uint32_t> TEdgeSupport;
+    // Edges, keyed on the packed (id1, id2) pair
+    typedef boost::unordered_map<uint64_t, uint32_t> TEdgeSupport;
     TEdgeSupport es;
-    computelinks(readSeg1, es);
-    computelinks(readSeg2, es);
+    computelinks(splitReads1, regionOffset, es);
+    computelinks(splitReads2, regionOffset, es);
+    if ((!splitReads1.good) || (!splitReads2.good)) {
+      std::cerr << "Error: Temporary split-read files in " << c.tmpdir.string() << " could not be written or are truncated" << std::endl;
+      return false;
+    }
+
+    // Sorted edge list with per-node offsets
+    typedef std::vector<std::pair<uint64_t, uint32_t> > TEdgeList;
+    TEdgeList edges(es.begin(), es.end());
+    TEdgeSupport().swap(es);
+    std::sort(edges.begin(), edges.end());
+    std::vector<uint32_t> edgeStart(sgm.size() + 1, 0);
+    for(uint32_t k = 0; k < edges.size(); ++k) ++edgeStart[edgeSource(edges[k].first) + 1];
+    for(uint32_t i = 0; i < sgm.size(); ++i) edgeStart[i+1] += edgeStart[i];
+    st.splitReads += splitReads1.size() + splitReads2.size();
+    st.segments += sgm.size();
+    st.edges += edges.size();
+    st.link += sw.lap();
     
     // Segment connections    
     now = boost::posix_time::second_clock::local_time();	  
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Computing connected components" << std::endl;
-    segconnect(c, es, sgm);
+    segconnect(c, edges, sgm);
 
     // Filter singletons or clusters where all segments are nearby
     std::vector<bool> confirmed(sgm.size(), false);  // Confirmed by component id (cid)
@@ -457,62 +1164,452 @@ namespace rayas
       }
     }
 
-    // Compute node degree (without self edges)
+    // Compute node degree (without self edges) and self-edge support
     std::vector<uint32_t> degree(sgm.size(), 0);
-    for(uint32_t i = 0; i < sgm.size(); ++i) {
-      for(uint32_t j = i + 1; j < sgm.size(); ++j) {
-	if (es.find(std::make_pair(i, j)) != es.end()) {
-	  if (es[std::make_pair(i, j)] >= c.minSplit) {
-	    degree[i] += es[std::make_pair(i, j)];
-	    degree[j] += es[std::make_pair(i, j)];
-	  }
-	}
+    std::vector<uint32_t> selfdegree(sgm.size(), 0);
+    for(uint32_t k = 0; k < edges.size(); ++k) {
+      if (edges[k].second < c.minSplit) continue;
+      uint32_t id1 = edgeSource(edges[k].first);
+      uint32_t id2 = edgeTarget(edges[k].first);
+      if (id1 == id2) selfdegree[id1] = edges[k].second;
+      else {
+	degree[id1] += edges[k].second;
+	degree[id2] += edges[k].second;
       }
     }
 	
-    // Output segments
-    std::ofstream ofile(c.outfile.string().c_str());
-    ofile << "chr\tstart\tend\tnodeid\tselfdegree\tdegree\testcn\tclusterid\tedges" << std::endl;
+    st.components += sw.lap();
+
+    // Output segments, a compressed BED is tabix-indexed
+    OutputWriter ofile;
+    if (!ofile.open(outfile)) {
+      std::cerr << "Error: Output file " << outfile.string() << " cannot be opened" << std::endl;
+      return false;
+    }
+    ofile << "chr\tstart\tend\tnodeid\tselfdegree\tdegree\testcn\tclusterid\tedges";
+    ofile.endl();
     for(uint32_t i = 0; i < sgm.size(); ++i) {
       if (confirmed[sgm[i].cid]) {
-	ofile << hdr->target_name[sgm[i].refIndex] << '\t' << sgm[i].start << '\t' << sgm[i].end << '\t';
-	ofile << i << "[label=\"" << hdr->target_name[sgm[i].refIndex] << ':' << sgm[i].start << '-' << sgm[i].end << "(" << sgm[i].cid << ")" <<  "\"];" << '\t';
-	if ((es.find(std::make_pair(i, i)) != es.end()) && (es[std::make_pair(i, i)] >= c.minSplit)) {
-	  ofile << es[std::make_pair(i, i)] << '\t';
-	} else {
-	  ofile << "0\t";
-	}
+	++st.confirmed;
+	ofile << chrNames[sgm[i].refIndex] << '\t' << sgm[i].start << '\t' << sgm[i].end << '\t';
+	ofile << i << "[label=\"" << chrNames[sgm[i].refIndex] << ':' << sgm[i].start << '-' << sgm[i].end << "(" << sgm[i].cid << ")" <<  "\"];" << '\t';
+	ofile << selfdegree[i] << '\t';
 	ofile << degree[i] << '\t' << sgm[i].cn << '\t' << sgm[i].cid << '\t';
-	for(uint32_t id2 = i; id2 < sgm.size(); ++id2) {
-	  if (es.find(std::make_pair(i, id2)) != es.end()) {
-	    if (es[std::make_pair(i, id2)] >= c.minSplit) {
-	      ofile << i << "--" << id2 << "[label=\"" << es[std::make_pair(i, id2)] << "\"];";
+	for(uint32_t k = edgeStart[i]; k < edgeStart[i+1]; ++k) {
+	  if (edges[k].second >= c.minSplit) {
+	    ofile << i << "--" << edgeTarget(edges[k].first) << "[label=\"" << edges[k].second << "\"];";
+	  }
+	}
+	ofile.endl();
+      }
+    }
+    if ((!ofile.close()) || ((compressedPath(outfile)) && (!indexBed(outfile)))) {
+      std::cerr << "Error: Output file " << outfile.string() << " could not be written" << std::endl;
+      return false;
+    }
+    if ((!graphfile.empty()) && (!writeGraph(c, graphfile, chrNames, sgm, confirmed, edges, edgeStart))) {
+      std::cerr << "Error: Graph file " << graphfile.string() << " could not be written" << std::endl;
+      return false;
+    }
+    st.output += sw.lap();
+    return true;
+  }
+
+  // Mean depth of the deepest contig longer than minChrLen (any contig if there is none) from the index statistics and the aligned length of the first reads, 0 if the index has no statistics
+  template<typename TConfig>
+  inline uint32_t
+  indexDepth(TConfig const& c, boost::filesystem::path const& path) {
+    samFile* fp = sam_open(path.string().c_str(), "r");
+    if (fp == NULL) return 0;
+    hts_set_fai_filename(fp, c.genome.string().c_str());
+    requiredFields(fp);
+    hts_idx_t* idx = sam_index_load(fp, path.string().c_str());
+    bam_hdr_t* hdr = sam_hdr_read(fp);
+    uint64_t depth = 0;
+    if ((idx != NULL) && (hdr != NULL)) {
+      uint64_t bases = 0;
+      uint32_t n = 0;
+      bam1_t* rec = bam_init1();
+      while ((n < 1000) && (sam_read1(fp, hdr, rec) >= 0)) {
+	if (rec->core.flag & (BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) continue;
+	bases += bam_cigar2rlen(rec->core.n_cigar, bam_get_cigar(rec));
+	++n;
+      }
+      bam_destroy1(rec);
+      bool anyLong = false;
+      for(int32_t refIndex = 0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
+	if (hdr->target_len[refIndex] > c.minChrLen) anyLong = true;
+      }
+      for(int32_t refIndex = 0; (n) && (refIndex < (int32_t) hdr->n_targets); ++refIndex) {
+	if ((anyLong) && (hdr->target_len[refIndex] <= c.minChrLen)) continue;
+	uint64_t mapped = 0;
+	uint64_t unmapped = 0;
+	if ((hdr->target_len[refIndex] == 0) || (hts_idx_get_stat(idx, refIndex, &mapped, &unmapped) < 0)) continue;
+	depth = std::max(depth, mapped * (bases / n) / hdr->target_len[refIndex]);
+      }
+    }
+    if (hdr != NULL) bam_hdr_destroy(hdr);
+    if (idx != NULL) hts_idx_destroy(idx);
+    sam_close(fp);
+    return std::min(depth, (uint64_t) std::numeric_limits<uint32_t>::max());
+  }
+
+  // Initial clip counter width, 8-bit clips need to hold the split-read threshold and regions that saturate it are parsed again with 32-bit counters
+  inline uint32_t
+  counterBits(uint32_t const depth, uint16_t const minSplit) {
+    if (!depth) return 16;
+    if ((depth <= 32) && (minSplit <= std::numeric_limits<uint8_t>::max())) return 8;
+    if (depth > 1024) return 32;
+    return 16;
+  }
+
+  template<typename TValue, typename TConfig>
+  inline int32_t
+  runCall(TConfig& c) {
+    
+#ifdef PROFILE
+    ProfilerStart("rayas.prof");
+#endif
+    Stopwatch wallclock;
+    CallStats stats;
+
+    // Load header
+    samFile* samfile = sam_open(c.tumor.string().c_str(), "r");
+    hts_set_fai_filename(samfile, c.genome.string().c_str());
+    hts_idx_t* sidx = sam_index_load(samfile, c.tumor.string().c_str());
+    bam_hdr_t* hdr = sam_hdr_read(samfile);
+
+    // Further tumors need the same reference contigs
+    for(uint32_t t = 1; t < c.tumors.size(); ++t) {
+      samFile* tfile = sam_open(c.tumors[t].string().c_str(), "r");
+      bam_hdr_t* thdr = (tfile != NULL) ? sam_hdr_read(tfile) : NULL;
+      bool same = ((thdr != NULL) && (thdr->n_targets == hdr->n_targets));
+      for(int32_t refIndex = 0; (same) && (refIndex < (int32_t) hdr->n_targets); ++refIndex) {
+	same = ((thdr->target_len[refIndex] == hdr->target_len[refIndex]) && (std::string(thdr->target_name[refIndex]) == std::string(hdr->target_name[refIndex])));
+      }
+      if (thdr != NULL) bam_hdr_destroy(thdr);
+      if (tfile != NULL) sam_close(tfile);
+      if (!same) {
+	std::cerr << "Error: " << c.tumors[t].string() << " cannot be opened or its reference contigs differ from " << c.tumor.string() << std::endl;
+	bam_hdr_destroy(hdr);
+	hts_idx_destroy(sidx);
+	sam_close(samfile);
+	return 1;
+      }
+    }
+
+    // Regions to process, whole chromosomes by default
+    std::vector<Region> regions;
+    std::vector<hts_idx_t*> ridxs(1, sidx);
+    for(uint32_t t = 1; t < c.tumors.size(); ++t) ridxs.push_back(loadIndex(c, c.tumors[t]));
+    hts_idx_t* rcidx = loadIndex(c, c.control);
+    bool regionsOk = parseRegions(c, hdr, ridxs, rcidx, regions);
+    for(uint32_t t = 1; t < ridxs.size(); ++t) {
+      if (ridxs[t] != NULL) hts_idx_destroy(ridxs[t]);
+    }
+    if (rcidx != NULL) hts_idx_destroy(rcidx);
+    if (!regionsOk) {
+      bam_hdr_destroy(hdr);
+      hts_idx_destroy(sidx);
+      sam_close(samfile);
+      return 1;
+    }
+    
+    // Regions are processed independently, results are merged in region order below
+    typedef std::vector<Segment> TSegments;
+    typedef std::pair<ReadId, uint32_t> TReadPos;
+    typedef std::vector<TReadPos> TChrReadPos;
+    uint32_t nt = c.tumors.size();
+    std::vector<std::vector<TSegments> > regionSgm(nt, std::vector<TSegments>(regions.size()));
+    stats.regions.resize(regions.size());
+
+    // Region buffers are sized once to the largest window
+    uint32_t maxlen = 0;
+    for(uint32_t ri = 0; ri < regions.size(); ++ri) {
+      uint32_t wstart = 0;
+      uint32_t wend = 0;
+      regionWindow(c, hdr, regions[ri], wstart, wend);
+      maxlen = std::max(maxlen, wend - wstart);
+    }
+
+    // Split-reads of all regions per tumor, spilled to sorted runs on disk beyond the memory limit
+    uint64_t linkmem = (uint64_t) c.linkmem * 1024 * 1024 / nt;
+    boost::ptr_vector<ExternalSorter<SplitRead> > splitReads1;
+    boost::ptr_vector<ExternalSorter<SplitRead> > splitReads2;
+    for(uint32_t t = 0; t < nt; ++t) {
+      splitReads1.push_back(new ExternalSorter<SplitRead>(linkmem / 2, c.tmpdir));
+      splitReads2.push_back(new ExternalSorter<SplitRead>(linkmem / 2, c.tmpdir));
+    }
+
+    // Regions with a valid checkpoint are not parsed again
+    uint64_t fingerprint = checkpointFingerprint(c);
+
+    // Partial output, one record per region
+    boost::filesystem::path partialTmp(c.partial.string() + ".tmp");
+    std::ofstream partial;
+    if (!c.partial.empty()) {
+      partial.open(partialTmp.string().c_str(), std::ios::out | std::ios::binary);
+      if (!partial.is_open()) {
+	std::cerr << "Error: Partial file " << c.partial.string() << " cannot be opened" << std::endl;
+	bam_hdr_destroy(hdr);
+	hts_idx_destroy(sidx);
+	sam_close(samfile);
+	return 1;
+      }
+    }
+
+    // Precomputed N-runs of the reference, if available, a default mask of another reference index is ignored
+    NRuns nruns;
+    NRuns const* nrunsPtr = NULL;
+    boost::filesystem::path maskPath = c.nmask.empty() ? defaultMaskPath(c.genome) : c.nmask;
+    uint64_t checksum = faiChecksum(c.genome);
+    if ((checksum) && (maskChecksum(maskPath) == checksum)) {
+      std::map<std::string, uint32_t> chrLen;
+      if ((!faiLengths(c.genome, chrLen)) || (!readNRuns(maskPath, checksum, chrLen, nruns))) {
+	std::cerr << "Error: N-mask " << maskPath.string() << " is truncated or damaged, rebuild it with rayas mask" << std::endl;
+	bam_hdr_destroy(hdr);
+	hts_idx_destroy(sidx);
+	sam_close(samfile);
+	return 1;
+      }
+      nrunsPtr = &nruns;
+      std::cout << "Using N-mask " << maskPath.string() << std::endl;
+    }
+    else if (!c.nmask.empty()) {
+      std::cerr << "Error: N-mask " << c.nmask.string() << " is missing or does not match " << c.genome.string() << ".fai" << std::endl;
+      bam_hdr_destroy(hdr);
+      hts_idx_destroy(sidx);
+      sam_close(samfile);
+      return 1;
+    }
+
+    // Clip and coverage tracks, written while parsing or read instead of the alignments
+    uint64_t trackFp = trackFingerprint(c);
+    TrackIndex trackIndex;
+    trackIndex.fingerprint = trackFp;
+    BGZF* trackOut = NULL;
+    boost::filesystem::path tracksTmp(c.dumpTracks.string() + ".tmp");
+    if (!c.dumpTracks.empty()) {
+      trackOut = openTrackWriter(tracksTmp, trackFp);
+      if (trackOut == NULL) {
+	std::cerr << "Error: Track file " << c.dumpTracks.string() << " cannot be opened" << std::endl;
+	bam_hdr_destroy(hdr);
+	hts_idx_destroy(sidx);
+	sam_close(samfile);
+	return 1;
+      }
+    }
+    if (!c.tracks.empty()) {
+      BGZF* fp = openTrackReader(c.tracks, trackFp);
+      if ((fp == NULL) || (!readTrackIndex(c.tracks, trackFp, trackIndex))) {
+	std::cerr << "Error: Track file " << c.tracks.string() << " or its index is missing, damaged or was generated with different parsing parameters or input files" << std::endl;
+	if (fp != NULL) bgzf_close(fp);
+	bam_hdr_destroy(hdr);
+	hts_idx_destroy(sidx);
+	sam_close(samfile);
+	return 1;
+      }
+      bgzf_close(fp);
+      std::cout << "Using tracks " << c.tracks.string() << std::endl;
+    }
+    bool trackError = false;
+    bool trackWriteError = false;
+
+    // Decompression thread pools, one for the tumors and one for the control, shared by the file handles of all workers
+    // Each worker contributes iothreads threads to either pool, so decompression scales with the number of workers
+    htsThreadPool tpool = {NULL, 0};
+    htsThreadPool cpool = {NULL, 0};
+    if (c.iothreads > 0) {
+      tpool.pool = hts_tpool_init(c.threads * c.iothreads);
+      cpool.pool = hts_tpool_init(c.threads * c.iothreads);
+    }
+#ifdef OPENMP
+    // Reader and analysis stage of a pipelined worker are a nested team
+    if (c.pipeline) omp_set_max_active_levels(2);
+#endif
+#pragma omp parallel num_threads(c.threads)
+    {
+      // Per-thread file handles
+      std::vector<samFile*> tfiles(nt);
+      std::vector<hts_idx_t*> idxs(nt);
+      std::vector<bam_hdr_t*> thdrs(nt);
+      for(uint32_t t = 0; t < nt; ++t) {
+	tfiles[t] = sam_open(c.tumors[t].string().c_str(), "r");
+	hts_set_fai_filename(tfiles[t], c.genome.string().c_str());
+	requiredFields(tfiles[t]);
+	if (tpool.pool) hts_set_thread_pool(tfiles[t], &tpool);
+	idxs[t] = sam_index_load(tfiles[t], c.tumors[t].string().c_str());
+	thdrs[t] = sam_hdr_read(tfiles[t]);
+      }
+      samFile* cfile = sam_open(c.control.string().c_str(), "r");
+      hts_set_fai_filename(cfile, c.genome.string().c_str());
+      requiredFields(cfile);
+      if (cpool.pool) hts_set_thread_pool(cfile, &cpool);
+      hts_idx_t* cidx = sam_index_load(cfile, c.control.string().c_str());
+      bam_hdr_t* chdr = sam_hdr_read(cfile);
+      faidx_t* fai = fai_load(c.genome.string().c_str());
+      // A pipelined worker loads the next region into the second arena while the first one is analysed
+      boost::ptr_vector<RegionArena<TValue, TChrReadPos> > arena;
+      arena.push_back(new RegionArena<TValue, TChrReadPos>(maxlen, !c.compact, c.pipeline ? nt : 1));
+      if (c.pipeline) arena.push_back(new RegionArena<TValue, TChrReadPos>(maxlen, !c.compact, nt));
+      // 32-bit buffers, only allocated once a region saturates the counters
+      boost::ptr_vector<RegionArena<uint32_t, TChrReadPos> > wide;
+      TrackHandle th;
+      th.index = &trackIndex;
+      th.failed = &trackWriteError;
+      if (trackOut != NULL) {
+	th.fp = trackOut;
+	th.dump = true;
+      } else if (!c.tracks.empty()) {
+	th.fp = openTrackReader(c.tracks, trackFp);
+	th.load = true;
+      }
+
+      // Parse genome, process region by region
+      int32_t nregions = regions.size();
+      if (!c.pipeline) {
+#pragma omp for schedule(dynamic, 1)
+	for(int32_t ri = 0; ri < nregions; ++ri) {
+	  RegionJob<TSegments, TChrReadPos> job(nt);
+	  startRegion(c, fingerprint, tfiles, idxs, cfile, cidx, fai, nrunsPtr, hdr, regions[ri], th, arena[0], false, job, stats.regions[ri]);
+	  finishRegion(c, fingerprint, tfiles, idxs, cfile, cidx, ri, regions[ri], th, arena[0], false, job, stats.regions[ri], partial, regionSgm, splitReads1, splitReads2, trackError);
+	  widenRegion(c, fingerprint, tfiles, idxs, cfile, cidx, fai, nrunsPtr, hdr, ri, regions[ri], th, maxlen, wide, job, stats.regions[ri], partial, regionSgm, splitReads1, splitReads2, trackError);
+	}
+      } else {
+	// Regions are dealt round-robin, in step k the reader stage loads region k while the analysis stage works on region k-1
+	int32_t nworkers = 1;
+	int32_t w = 0;
+#ifdef OPENMP
+	nworkers = omp_get_num_threads();
+	w = omp_get_thread_num();
+#endif
+	std::vector<RegionJob<TSegments, TChrReadPos> > jobs(2, RegionJob<TSegments, TChrReadPos>(nt));
+	for(int32_t k = 0; w + (k - 1) * nworkers < nregions; ++k) {
+	  int32_t next = w + k * nworkers;
+	  int32_t cur = next - nworkers;
+#pragma omp parallel sections num_threads(2)
+	  {
+#pragma omp section
+	    {
+	      if (next < nregions) {
+		jobs[k % 2] = RegionJob<TSegments, TChrReadPos>(nt);
+		startRegion(c, fingerprint, tfiles, idxs, cfile, cidx, fai, nrunsPtr, hdr, regions[next], th, arena[k % 2], true, jobs[k % 2], stats.regions[next]);
+	      }
+	    }
+#pragma omp section
+	    {
+	      if (cur >= 0) finishRegion(c, fingerprint, tfiles, idxs, cfile, cidx, cur, regions[cur], th, arena[(k + 1) % 2], true, jobs[(k + 1) % 2], stats.regions[cur], partial, regionSgm, splitReads1, splitReads2, trackError);
 	    }
 	  }
+	  if (cur >= 0) widenRegion(c, fingerprint, tfiles, idxs, cfile, cidx, fai, nrunsPtr, hdr, cur, regions[cur], th, maxlen, wide, jobs[(k + 1) % 2], stats.regions[cur], partial, regionSgm, splitReads1, splitReads2, trackError);
+	}
+      }
+
+      // Clean-up
+      if ((th.load) && (th.fp != NULL)) bgzf_close(th.fp);
+      fai_destroy(fai);
+      for(uint32_t t = 0; t < nt; ++t) {
+	bam_hdr_destroy(thdrs[t]);
+	hts_idx_destroy(idxs[t]);
+	sam_close(tfiles[t]);
+      }
+      bam_hdr_destroy(chdr);
+      hts_idx_destroy(cidx);
+      sam_close(cfile);
+    }
+    if (tpool.pool) hts_tpool_destroy(tpool.pool);
+    if (cpool.pool) hts_tpool_destroy(cpool.pool);
+    if (trackOut != NULL) {
+      boost::system::error_code ec;
+      if (trackWriteError) {
+	bgzf_close(trackOut);
+	ec = boost::system::errc::make_error_code(boost::system::errc::io_error);
+      }
+      else if (closeTrackWriter(trackOut, c.dumpTracks, trackIndex)) boost::filesystem::rename(tracksTmp, c.dumpTracks, ec);
+      else ec = boost::system::errc::make_error_code(boost::system::errc::io_error);
+      if (ec) {
+	std::cerr << "Error: Track file " << c.dumpTracks.string() << " could not be written" << std::endl;
+	boost::filesystem::remove(tracksTmp);
+	trackError = true;
+      }
+    }
+    if (trackError) {
+      if (partial.is_open()) {
+	partial.close();
+	boost::filesystem::remove(partialTmp);
+      }
+      bam_hdr_destroy(hdr);
+      hts_idx_destroy(sidx);
+      sam_close(samfile);
+      return 1;
+    }
+
+    std::vector<std::string> chrNames;
+    for(int32_t refIndex = 0; refIndex < (int32_t) hdr->n_targets; ++refIndex) chrNames.push_back(hdr->target_name[refIndex]);
+    if (partial.is_open()) {
+      // Linking is left to rayas merge
+      partial.close();
+      boost::system::error_code ec;
+      if (partial) boost::filesystem::rename(partialTmp, c.partial, ec);
+      if ((!partial) || (ec)) {
+	std::cerr << "Error: Partial file " << c.partial.string() << " could not be written" << std::endl;
+	boost::filesystem::remove(partialTmp);
+	bam_hdr_destroy(hdr);
+	hts_idx_destroy(sidx);
+	sam_close(samfile);
+	return 1;
+      }
+    } else {
+      for(uint32_t t = 0; t < nt; ++t) {
+	if (nt > 1) {
+	  boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+	  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Linking " << c.tumors[t].string() << std::endl;
+	}
+	if (!linkSegments(c, chrNames, regionSgm[t], splitReads1[t], splitReads2[t], c.outfiles[t], c.graphs[t], stats)) {
+	  bam_hdr_destroy(hdr);
+	  hts_idx_destroy(sidx);
+	  sam_close(samfile);
+	  return 1;
 	}
-	ofile << std::endl;
       }
     }
-    ofile.close();
     
     // Clean-up
     bam_hdr_destroy(hdr);
-    fai_destroy(fai);
-    hts_idx_destroy(idx);
+    hts_idx_destroy(sidx);
     sam_close(samfile);
-    hts_idx_destroy(cidx);
-    sam_close(cfile);
     
 #ifdef PROFILE
     ProfilerStop();
 #endif
+    stats.wall = wallclock.lap().wall;
+    if (c.timing) printTimes(stats, c.threads);
+    if ((!c.statsfile.empty()) && (!writeStats(c.statsfile, stats, chrNames))) {
+      std::cerr << "Error: Statistics could not be written to " << c.statsfile.string() << std::endl;
+      return 1;
+    }
     
     // End
-    now = boost::posix_time::second_clock::local_time();
+    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] Done." << std::endl;
     return 0;
   }
 
+  // Counter width from the deepest sample unless given
+  template<typename TConfig>
+  inline int32_t
+  runCall(TConfig& c) {
+    if (!c.counters) {
+      uint32_t depth = indexDepth(c, c.control);
+      for(uint32_t t = 0; t < c.tumors.size(); ++t) depth = std::max(depth, indexDepth(c, c.tumors[t]));
+      c.counters = counterBits(depth, c.minSplit);
+      if (depth) std::cout << "Estimated depth " << depth << "x, " << c.counters << "-bit clip counters" << std::endl;
+    }
+    if (c.counters == 8) return runCall<uint8_t>(c);
+    else if (c.counters == 32) return runCall<uint32_t>(c);
+    else return runCall<uint16_t>(c);
+  }
+
 
   
   int call(int argc, char** argv) {
@@ -526,20 +1623,40 @@ namespace rayas
       ("clip,c", boost::program_options::value<uint16_t>(&c.minClip)->default_value(25), "min. clipping length")
       ("split,s", boost::program_options::value<uint16_t>(&c.minSplit)->default_value(3), "min. split-read support")
       ("ploidy,p", boost::program_options::value<uint32_t>(&c.ploidy)->default_value(2), "ploidy")
+      ("threads,t", boost::program_options::value<uint32_t>(&c.threads)->default_value(1), "number of threads")
+      ("iothreads", boost::program_options::value<uint32_t>(&c.iothreads)->default_value(2), "decompression threads per worker thread for the tumors and for the control, 0 disables")
       ("chrlen,l", boost::program_options::value<uint32_t>(&c.minChrLen)->default_value(40000000), "min. chromosome length")
       ("minsize,i", boost::program_options::value<uint32_t>(&c.minSegmentSize)->default_value(100), "min. segment size")
       ("maxsize,j", boost::program_options::value<uint32_t>(&c.maxSegmentSize)->default_value(10000), "max. segment size")
       ("minsegdist,e", boost::program_options::value<uint32_t>(&c.minSegDist)->default_value(10000), "min. distance between segments")
       ("contam,n", boost::program_options::value<float>(&c.contam)->default_value(0), "max. fractional tumor-in-normal contamination")
+      ("max-depth", boost::program_options::value<uint32_t>(&c.maxDepth)->default_value(0), "subsample reads beyond this depth with weighted counts, 0 disables")
       ("sd,d", boost::program_options::value<float>(&c.sdthres)->default_value(3), "coverage cutoff, median + d*SD")
       ("genome,g", boost::program_options::value<boost::filesystem::path>(&c.genome), "genome fasta file")
       ("matched,m", boost::program_options::value<boost::filesystem::path>(&c.control), "matched control BAM")
-      ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile)->default_value("out.bed"), "BED output file")
+      ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile)->default_value("out.bed"), "BED output file, tabix-indexed if it ends in .gz")
+      ("graph", boost::program_options::value<boost::filesystem::path>(&c.graph)->default_value(""), "segment graph output, GFA for .gfa or an edge list otherwise")
+      ("region,r", boost::program_options::value<std::string>(&c.region)->default_value(""), "only call in region chr:start-end")
+      ("bed,b", boost::program_options::value<boost::filesystem::path>(&c.bedfile)->default_value(""), "only call in BED regions")
+      ("nmask", boost::program_options::value<boost::filesystem::path>(&c.nmask)->default_value(""), "N-mask of rayas mask [default: <genome.fa>.nmask if present]")
+      ("counters", boost::program_options::value<uint32_t>(&c.counters)->default_value(0), "clip counter width in bits (8, 16 or 32), 0 selects it from the index depth")
+      ("compact", "sparse clipping counts and block-packed coverage to reduce memory")
+      ("pipeline", "load the next region while the current one is analysed, two threads and region buffers per worker")
+      ("double-hash", "identify split-reads by two independently seeded 64-bit name hashes instead of one")
+      ("timing", "report per-stage timings, throughput and peak memory")
+      ("stats", boost::program_options::value<boost::filesystem::path>(&c.statsfile)->default_value(""), "per-region and per-stage statistics in JSON format")
+      ("linkmem", boost::program_options::value<uint32_t>(&c.linkmem)->default_value(1024), "max. memory in MB for split-reads before spilling to disk")
+      ("tmpdir", boost::program_options::value<boost::filesystem::path>(&c.tmpdir)->default_value(boost::filesystem::temp_directory_path()), "directory for temporary files")
+      ("chr", boost::program_options::value<std::string>(&c.chr)->default_value(""), "process only this chromosome")
+      ("partial", boost::program_options::value<boost::filesystem::path>(&c.partial)->default_value(""), "write segments and split-reads to a partial file for rayas merge")
+      ("checkpoint-dir", boost::program_options::value<boost::filesystem::path>(&c.checkpointDir)->default_value(""), "per-chromosome checkpoints, a restarted run skips finished chromosomes")
+      ("dump-tracks", boost::program_options::value<boost::filesystem::path>(&c.dumpTracks)->default_value(""), "write tumor and control clips and coverage to a binary track file")
+      ("tracks", boost::program_options::value<boost::filesystem::path>(&c.tracks)->default_value(""), "read clips and coverage from a --dump-tracks file instead of the alignments")
       ;
     
     boost::program_options::options_description hidden("Hidden options");
     hidden.add_options()
-      ("input-file", boost::program_options::value<boost::filesystem::path>(&c.tumor), "input file")
+      ("input-file", boost::program_options::value<std::vector<boost::filesystem::path> >(&c.tumors), "input files")
       ;
     
     boost::program_options::positional_options_description pos_args;
@@ -555,11 +1672,86 @@ namespace rayas
     
     // Check command line arguments
     if ((vm.count("help")) || (!vm.count("input-file")) || (!vm.count("genome")) || (!vm.count("matched"))) {
-      std::cout << "Usage: rayas " << argv[0] << " [OPTIONS] -g <ref.fa> -m <control.bam> <tumor.bam>" << std::endl;
+      std::cout << "Usage: rayas " << argv[0] << " [OPTIONS] -g <ref.fa> -m <control.bam> <tumor1.bam> <tumor2.bam> ..." << std::endl;
       std::cout << visible_options << "\n";
       return -1;
     }
 
+    // Tumors share the control, each tumor has its own output file
+    c.tumor = c.tumors[0];
+    if (c.tumors.size() == 1) {
+      c.outfiles.push_back(c.outfile);
+      c.graphs.push_back(c.graph);
+    } else {
+      std::set<std::string> names;
+      for(uint32_t t = 0; t < c.tumors.size(); ++t) {
+	std::string name = c.tumors[t].stem().string();
+	if (!names.insert(name).second) {
+	  std::cerr << "Error: Tumor file names need to be unique, " << name << " is given more than once" << std::endl;
+	  return 1;
+	}
+	c.outfiles.push_back(samplePath(c.outfile, name));
+	c.graphs.push_back(c.graph.empty() ? c.graph : samplePath(c.graph, name));
+      }
+      if ((!c.partial.empty()) || (!c.checkpointDir.empty()) || (!c.dumpTracks.empty()) || (!c.tracks.empty())) {
+	std::cerr << "Error: --partial, --checkpoint-dir and track files support a single tumor" << std::endl;
+	return 1;
+      }
+    }
+
+    // Storage mode
+    if (vm.count("compact")) c.compact = true;
+    else c.compact = false;
+    if (vm.count("pipeline")) c.pipeline = true;
+    else c.pipeline = false;
+
+    // Read identity
+    if (vm.count("double-hash")) c.doubleHash = true;
+    else c.doubleHash = false;
+
+    // Checkpoint directory
+    if (!c.checkpointDir.empty()) {
+      boost::system::error_code ec;
+      boost::filesystem::create_directories(c.checkpointDir, ec);
+      if ((ec) || (!boost::filesystem::is_directory(c.checkpointDir))) {
+	std::cerr << "Error: Checkpoint directory " << c.checkpointDir.string() << " cannot be created" << std::endl;
+	return 1;
+      }
+    }
+
+    // Tracks hold dense clips and coverage of freshly parsed regions
+    if ((!c.dumpTracks.empty()) || (!c.tracks.empty())) {
+      if ((!c.dumpTracks.empty()) && (!c.tracks.empty())) {
+	std::cerr << "Error: --dump-tracks and --tracks are mutually exclusive" << std::endl;
+	return 1;
+      }
+      if (c.compact) {
+	std::cerr << "Error: Track files require dense storage, --compact is not supported" << std::endl;
+	return 1;
+      }
+      if ((!c.dumpTracks.empty()) && (!c.checkpointDir.empty())) {
+	std::cerr << "Error: Regions restored from checkpoints cannot be written to --dump-tracks" << std::endl;
+	return 1;
+      }
+    }
+
+    // Counter width
+    if ((c.counters != 0) && (c.counters != 8) && (c.counters != 16) && (c.counters != 32)) {
+      std::cerr << "Error: --counters needs to be 0, 8, 16 or 32" << std::endl;
+      return 1;
+    }
+    if ((c.counters == 8) && (c.minSplit > std::numeric_limits<uint8_t>::max())) {
+      std::cerr << "Error: 8-bit clip counters cannot hold a split-read support of " << c.minSplit << std::endl;
+      return 1;
+    }
+
+    // Stage timings
+    if (vm.count("timing")) c.timing = true;
+    else c.timing = false;
+
+    // Check threads
+    if (c.threads < 1) c.threads = 1;
+
     // Show cmd
     boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
@@ -0,0 +1,207 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cctype>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+namespace rayas
+{
+
+  // Binary per-region results, checkpoints hold one record and partial files any number of records
+  static char const ckptMagic[8] = {'R', 'A', 'Y', 'A', 'S', 'C', 'K', 'P'};
+  static char const ckptTrailer[8] = {'R', 'A', 'Y', 'A', 'S', 'E', 'N', 'D'};
+  static uint32_t const ckptVersion = 3;
+
+  // Parameters, region set and input files a checkpoint depends on, checkpoints of other runs are ignored
+  // Targeted regions change the window flanks and the background estimate, so --region and the --bed content are part of it
+  template<typename TConfig>
+  inline uint64_t
+  checkpointFingerprint(TConfig const& c) {
+    std::ostringstream s;
+    s << c.minMapQual << ';' << c.minClip << ';' << c.minSplit << ';' << c.minSegmentSize << ';' << c.maxSegmentSize << ';' << c.minSegDist << ';' << c.ploidy << ';' << c.contam << ';' << c.sdthres << ';' << c.compact << ';' << c.doubleHash << ';' << c.maxDepth << ';' << c.counters << ';';
+    s << c.region << ';' << (c.bedfile.empty() ? 0 : fileDigest(c.bedfile)) << ';';
+    s << fileDigest(c.genome.string() + ".fai") << ';' << alignmentDigest(c.tumor, c.genome) << ';' << alignmentDigest(c.control, c.genome);
+    std::string str = s.str();
+    return hash_string(str.c_str(), str.size(), 0);
+  }
+
+  inline boost::filesystem::path
+  checkpointPath(boost::filesystem::path const& dir, std::string const& chrName, uint32_t const start, uint32_t const end, uint32_t const chrLen) {
+    std::string name(chrName);
+    for(uint32_t i = 0; i < name.size(); ++i) {
+      if ((!std::isalnum(name[i])) && (name[i] != '.') && (name[i] != '-') && (name[i] != '_')) name[i] = '_';
+    }
+    if ((start > 0) || (end < chrLen)) name += "_" + boost::lexical_cast<std::string>(start) + "_" + boost::lexical_cast<std::string>(end);
+    return dir / (name + ".ckpt");
+  }
+
+  template<typename TValue>
+  inline void
+  _ckptWrite(std::ofstream& ofs, TValue const& val) {
+    ofs.write(reinterpret_cast<char const*>(&val), sizeof(TValue));
+  }
+
+  template<typename TValue>
+  inline bool
+  _ckptRead(std::ifstream& ifs, TValue& val) {
+    ifs.read(reinterpret_cast<char*>(&val), sizeof(TValue));
+    return ifs.good();
+  }
+
+  template<typename TChrReadPos>
+  inline void
+  _ckptWriteReads(std::ofstream& ofs, TChrReadPos const& reads) {
+    _ckptWrite(ofs, (uint64_t) reads.size());
+    for(uint64_t i = 0; i < reads.size(); ++i) {
+      _ckptWrite(ofs, reads[i].first.h1);
+      _ckptWrite(ofs, reads[i].first.h2);
+      _ckptWrite(ofs, reads[i].second);
+    }
+  }
+
+  template<typename TChrReadPos>
+  inline bool
+  _ckptReadReads(std::ifstream& ifs, TChrReadPos& reads) {
+    uint64_t n = 0;
+    if (!_ckptRead(ifs, n)) return false;
+    reads.resize(n);
+    for(uint64_t i = 0; i < n; ++i) {
+      if ((!_ckptRead(ifs, reads[i].first.h1)) || (!_ckptRead(ifs, reads[i].first.h2)) || (!_ckptRead(ifs, reads[i].second))) return false;
+    }
+    return true;
+  }
+
+  // One region: header with the linking thresholds, segments, split-reads of read 1 and read 2, trailer
+  template<typename TSegments, typename TChrReadPos>
+  inline void
+  writeRecord(std::ofstream& ofs, uint64_t const fingerprint, uint16_t const minSplit, uint32_t const minSegDist, int32_t const refIndex, std::string const& chrName, uint32_t const start, uint32_t const end, TSegments const& sgm, TChrReadPos const& readSeg1, TChrReadPos const& readSeg2) {
+    ofs.write(ckptMagic, 8);
+    _ckptWrite(ofs, ckptVersion);
+    _ckptWrite(ofs, fingerprint);
+    _ckptWrite(ofs, minSplit);
+    _ckptWrite(ofs, minSegDist);
+    _ckptWrite(ofs, refIndex);
+    _ckptWrite(ofs, (uint32_t) chrName.size());
+    ofs.write(chrName.c_str(), chrName.size());
+    _ckptWrite(ofs, start);
+    _ckptWrite(ofs, end);
+    _ckptWrite(ofs, (uint32_t) sgm.size());
+    for(uint32_t i = 0; i < sgm.size(); ++i) {
+      _ckptWrite(ofs, sgm[i].start);
+      _ckptWrite(ofs, sgm[i].end);
+      _ckptWrite(ofs, sgm[i].cid);
+      _ckptWrite(ofs, sgm[i].cn);
+    }
+    _ckptWriteReads(ofs, readSeg1);
+    _ckptWriteReads(ofs, readSeg2);
+    ofs.write(ckptTrailer, 8);
+  }
+
+  struct RecordHeader {
+    uint64_t fingerprint;
+    uint16_t minSplit;
+    uint32_t minSegDist;
+    int32_t refIndex;
+    std::string chrName;
+    uint32_t start;
+    uint32_t end;
+  };
+
+  inline bool
+  readRecordHeader(std::ifstream& ifs, RecordHeader& rh) {
+    char magic[8];
+    ifs.read(magic, 8);
+    if ((!ifs.good()) || (!std::equal(magic, magic + 8, ckptMagic))) return false;
+    uint32_t version = 0;
+    uint32_t nameLen = 0;
+    if ((!_ckptRead(ifs, version)) || (version != ckptVersion) || (!_ckptRead(ifs, rh.fingerprint)) || (!_ckptRead(ifs, rh.minSplit)) || (!_ckptRead(ifs, rh.minSegDist)) || (!_ckptRead(ifs, rh.refIndex)) || (!_ckptRead(ifs, nameLen))) return false;
+    rh.chrName.assign(nameLen, ' ');
+    if (nameLen) ifs.read(&rh.chrName[0], nameLen);
+    return ((ifs.good()) && (_ckptRead(ifs, rh.start)) && (_ckptRead(ifs, rh.end)));
+  }
+
+  template<typename TSegments>
+  inline bool
+  readRecordSegments(std::ifstream& ifs, int32_t const refIndex, TSegments& sgm) {
+    typedef typename TSegments::value_type TSegment;
+    uint32_t nseg = 0;
+    if (!_ckptRead(ifs, nseg)) return false;
+    sgm.reserve(sgm.size() + nseg);
+    for(uint32_t i = 0; i < nseg; ++i) {
+      uint32_t s = 0;
+      uint32_t e = 0;
+      uint32_t cid = 0;
+      float cn = 0;
+      if ((!_ckptRead(ifs, s)) || (!_ckptRead(ifs, e)) || (!_ckptRead(ifs, cid)) || (!_ckptRead(ifs, cn))) return false;
+      sgm.push_back(TSegment(refIndex, s, e, cid, cn));
+    }
+    return true;
+  }
+
+  template<typename TChrReadPos>
+  inline bool
+  readRecordReads(std::ifstream& ifs, TChrReadPos& readSeg1, TChrReadPos& readSeg2) {
+    if ((!_ckptReadReads(ifs, readSeg1)) || (!_ckptReadReads(ifs, readSeg2))) return false;
+    char magic[8];
+    ifs.read(magic, 8);
+    return ((ifs.good()) && (std::equal(magic, magic + 8, ckptTrailer)));
+  }
+
+  // Skips the split-reads and the trailer
+  inline bool
+  skipRecordReads(std::ifstream& ifs) {
+    std::size_t const entry = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+    for(uint32_t k = 0; k < 2; ++k) {
+      uint64_t n = 0;
+      if (!_ckptRead(ifs, n)) return false;
+      ifs.seekg(n * entry, std::ios::cur);
+    }
+    char magic[8];
+    ifs.read(magic, 8);
+    return ((ifs.good()) && (std::equal(magic, magic + 8, ckptTrailer)));
+  }
+
+  // Written to a temporary file and renamed, an interrupted run never leaves a truncated checkpoint behind
+  template<typename TSegments, typename TChrReadPos>
+  inline bool
+  writeCheckpoint(boost::filesystem::path const& path, uint64_t const fingerprint, uint16_t const minSplit, uint32_t const minSegDist, int32_t const refIndex, std::string const& chrName, uint32_t const start, uint32_t const end, TSegments const& sgm, TChrReadPos const& readSeg1, TChrReadPos const& readSeg2) {
+    boost::filesystem::path tmp(path.string() + ".tmp");
+    std::ofstream ofs(tmp.string().c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open()) return false;
+    writeRecord(ofs, fingerprint, minSplit, minSegDist, refIndex, chrName, start, end, sgm, readSeg1, readSeg2);
+    ofs.close();
+    if (!ofs) {
+      boost::filesystem::remove(tmp);
+      return false;
+    }
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp, path, ec);
+    return (!ec);
+  }
+
+  // Segments are appended, returns false if the file is missing, truncated or belongs to another run or region
+  template<typename TSegments, typename TChrReadPos>
+  inline bool
+  readCheckpoint(boost::filesystem::path const& path, uint64_t const fingerprint, int32_t const refIndex, std::string const& chrName, uint32_t const start, uint32_t const end, TSegments& sgm, TChrReadPos& readSeg1, TChrReadPos& readSeg2) {
+    if (!boost::filesystem::exists(path)) return false;
+    std::ifstream ifs(path.string().c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) return false;
+    RecordHeader rh;
+    if ((!readRecordHeader(ifs, rh)) || (rh.fingerprint != fingerprint) || (rh.refIndex != refIndex) || (rh.chrName != chrName) || (rh.start != start) || (rh.end != end)) return false;
+    TSegments chrSgm;
+    TChrReadPos r1;
+    TChrReadPos r2;
+    if ((!readRecordSegments(ifs, refIndex, chrSgm)) || (!readRecordReads(ifs, r1, r2))) return false;
+    sgm.insert(sgm.end(), chrSgm.begin(), chrSgm.end());
+    readSeg1.swap(r1);
+    readSeg2.swap(r2);
+    return true;
+  }
+
+}
+
+#endif
@@ -0,0 +1,496 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <deque>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include <boost/type_traits/make_signed.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAYAS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace rayas
+{
+
+  // Track value types for clip counters of width TValue, coverage is at least 16-bit and its cumulative sum must not wrap within a segment
+  template<typename TValue>
+  struct CounterTraits {
+    typedef TValue TClip;
+    typedef TValue TCoverage;
+    typedef uint32_t TCumulative;
+  };
+
+  template<>
+  struct CounterTraits<uint8_t> {
+    typedef uint8_t TClip;
+    typedef uint16_t TCoverage;
+    typedef uint32_t TCumulative;
+  };
+
+  template<>
+  struct CounterTraits<uint32_t> {
+    typedef uint32_t TClip;
+    typedef uint32_t TCoverage;
+    typedef uint64_t TCumulative;
+  };
+
+  // Sorted (position, count) pairs for sparse clipping counts
+  template<typename TValue>
+  struct SparseCounts {
+    typedef TValue value_type;
+    typedef std::pair<uint32_t, TValue> TEntry;
+
+    std::vector<uint32_t> pos;
+    std::vector<TEntry> entries;
+
+    inline void
+    reset() {
+      pos.clear();
+      entries.clear();
+    }
+
+    inline void
+    increment(uint32_t const p, uint32_t const w) {
+      for(uint32_t k = 0; k < w; ++k) pos.push_back(p);
+    }
+
+    // Collapse collected positions into sorted counts, returns true if a count saturated
+    inline bool
+    finish() {
+      TValue maxval = std::numeric_limits<TValue>::max();
+      bool saturated = false;
+      std::sort(pos.begin(), pos.end());
+      entries.clear();
+      for(uint32_t i = 0; i < pos.size(); ++i) {
+	if ((!entries.empty()) && (entries.back().first == pos[i])) {
+	  if (entries.back().second < maxval) ++entries.back().second;
+	  else saturated = true;
+	} else entries.push_back(std::make_pair(pos[i], 1));
+      }
+      std::vector<uint32_t>().swap(pos);
+      return saturated;
+    }
+
+    inline TValue
+    operator[](uint32_t const p) const {
+      typename std::vector<TEntry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(p, (TValue) 0));
+      if ((it != entries.end()) && (it->first == p)) return it->second;
+      return 0;
+    }
+  };
+
+
+  // Coverage packed in 64bp blocks with a per-block minimum and bit width, exposes cumulative sums like a prefix-sum vector
+  template<typename TValue>
+  struct CompactCoverage {
+    typedef typename CounterTraits<TValue>::TCumulative value_type;
+
+    uint32_t len;
+    std::vector<value_type> cum;
+    std::vector<uint32_t> offset;
+    std::vector<TValue> base;
+    std::vector<uint8_t> width;
+    std::vector<uint64_t> words;
+
+    // Difference array of blocks that can still receive coverage, running holds the coverage before winStart
+    // Deltas are 64-bit, the window only spans the reads overlapping the current position
+    uint32_t winStart;
+    int64_t running;
+    std::deque<int64_t> win;
+    bool saturated;
+
+    CompactCoverage() : len(0), winStart(0), running(0), saturated(false) {
+      cum.push_back(0);
+    }
+
+    CompactCoverage(uint32_t const l) : len(l), winStart(0), running(0), saturated(false) {
+      cum.push_back(0);
+    }
+
+    // Empty coverage of length l, allocations are kept
+    inline void
+    reset(uint32_t const l) {
+      len = l;
+      cum.assign(1, 0);
+      offset.clear();
+      base.clear();
+      width.clear();
+      words.clear();
+      winStart = 0;
+      running = 0;
+      win.clear();
+      saturated = false;
+    }
+
+    inline void
+    add(uint32_t const start, uint32_t const oplen, uint32_t const w) {
+      if (start < winStart) return;
+      uint32_t end = std::min(start + oplen, len);
+      if (end <= start) return;
+      if (win.size() < end - winStart + 1) win.resize(end - winStart + 1, 0);
+      win[start - winStart] += w;
+      win[end - winStart] -= w;
+    }
+
+    // Reads are sorted, blocks ending at or before pos are final
+    inline void
+    flush(uint32_t const pos) {
+      while (winStart + 64 <= std::min(pos, len)) _pack();
+    }
+
+    inline void
+    finish() {
+      while (winStart < len) _pack();
+      std::deque<int64_t>().swap(win);
+    }
+
+    // Cumulative coverage in [0, pos)
+    inline value_type
+    operator[](uint32_t const pos) const {
+      uint32_t b = pos >> 6;
+      uint32_t k = pos & 63;
+      if (!k) return cum[b];
+      value_type s = cum[b] + (value_type) base[b] * k;
+      uint32_t w = width[b];
+      if (w) {
+	uint64_t mask = (w == 64) ? std::numeric_limits<uint64_t>::max() : ((1ULL << w) - 1);
+	for(uint32_t j = 0; j < k; ++j) {
+	  uint64_t bitpos = (uint64_t) j * w;
+	  uint64_t idx = offset[b] + (bitpos >> 6);
+	  uint32_t sh = bitpos & 63;
+	  uint64_t v = words[idx] >> sh;
+	  if (sh + w > 64) v |= words[idx + 1] << (64 - sh);
+	  s += (value_type) (v & mask);
+	}
+      }
+      return s;
+    }
+
+    inline std::size_t
+    size() const {
+      return (std::size_t) len + 1;
+    }
+
+    inline void
+    _pack() {
+      int64_t satval = std::numeric_limits<TValue>::max();
+      uint32_t n = std::min((uint32_t) 64, len - winStart);
+      if (win.size() < n) win.resize(n, 0);
+      TValue val[64] = {0};
+      for(uint32_t j = 0; j < n; ++j) {
+	running += win[j];
+	if (running > satval) saturated = true;
+	val[j] = (running < satval) ? running : satval;
+      }
+      TValue minval = val[0];
+      TValue maxval = val[0];
+      value_type sum = 0;
+      for(uint32_t j = 0; j < n; ++j) {
+	minval = std::min(minval, val[j]);
+	maxval = std::max(maxval, val[j]);
+	sum += val[j];
+      }
+      uint32_t w = 0;
+      while ((w < 64) && (((uint64_t) (maxval - minval)) >> w)) ++w;
+      cum.push_back(cum.back() + sum);
+      offset.push_back(words.size());
+      base.push_back(minval);
+      width.push_back(w);
+      if (w) {
+	// 64 values of w bits fill exactly w words
+	uint64_t first = words.size();
+	words.resize(words.size() + w, 0);
+	for(uint32_t j = 0; j < n; ++j) {
+	  uint64_t v = (uint64_t) (val[j] - minval);
+	  uint64_t bitpos = (uint64_t) j * w;
+	  uint64_t idx = first + (bitpos >> 6);
+	  uint32_t sh = bitpos & 63;
+	  words[idx] |= v << sh;
+	  if (sh + w > 64) words[idx + 1] |= v >> (64 - sh);
+	}
+      }
+      win.erase(win.begin(), win.begin() + n);
+      winStart += n;
+    }
+  };
+
+
+  // Dense storage
+  // Per-position track reused across regions, only the span written for the previous region is zeroed again
+  template<typename TValue>
+  struct DenseTrack {
+    std::vector<TValue> data;
+    std::vector<std::pair<uint32_t, int64_t> > overflow;
+    uint32_t dirtyStart;
+    uint32_t dirtyEnd;
+
+    DenseTrack() : dirtyStart(0), dirtyEnd(0) {}
+
+    // Zero-filled track of length len, the whole track counts as dirty until touched narrows it down
+    inline std::vector<TValue>&
+    reset(uint32_t const len) {
+      uint32_t end = std::min(dirtyEnd, (uint32_t) data.size());
+      if (dirtyStart < end) std::fill(data.begin() + dirtyStart, data.begin() + end, 0);
+      data.resize(len, 0);
+      overflow.clear();
+      dirtyStart = 0;
+      dirtyEnd = len;
+      return data;
+    }
+
+    inline void
+    touched(uint32_t const start, uint32_t const end) {
+      dirtyStart = start;
+      dirtyEnd = end;
+    }
+  };
+
+  // Prefix sums of a dense track over its touched span, the sum is 0 before the span and the total after it
+  template<typename TValue>
+  struct SpanPrefixSum {
+    typedef TValue value_type;
+
+    uint32_t len;
+    uint32_t start;
+    std::vector<TValue> sums;  // Cumulative sum in [0, start + k)
+
+    SpanPrefixSum() : len(0), start(0), sums(1, 0) {}
+
+    // Cumulative sum in [0, pos)
+    inline TValue
+    operator[](uint32_t const pos) const {
+      if (pos <= start) return 0;
+      uint32_t k = pos - start;
+      return (k < sums.size()) ? sums[k] : sums.back();
+    }
+
+    inline std::size_t
+    size() const {
+      return (std::size_t) len + 1;
+    }
+  };
+
+  template<typename TValue, typename TCumValue>
+  inline void
+  prefixSum(DenseTrack<TValue> const& cov, SpanPrefixSum<TCumValue>& cumcov) {
+    // Only the touched span is summed, wrap-around arithmetic keeps window sums exact as long as they fit into TCumValue
+    cumcov.len = cov.data.size();
+    uint32_t end = std::min(cov.dirtyEnd, cumcov.len);
+    uint32_t start = std::min(cov.dirtyStart, end);
+    cumcov.start = start;
+    cumcov.sums.resize(end - start + 1);
+    cumcov.sums[0] = 0;
+    for(uint32_t i = start; i < end; ++i) cumcov.sums[i - start + 1] = cumcov.sums[i - start] + cov.data[i];
+  }
+
+  // Saturating increment, returns true if the count exceeds the counter width
+  template<typename TValue>
+  inline bool
+  addClip(std::vector<TValue>& clips, uint32_t const pos, uint32_t const w) {
+    uint64_t val = (uint64_t) clips[pos] + w;
+    clips[pos] = std::min(val, (uint64_t) std::numeric_limits<TValue>::max());
+    return (val > std::numeric_limits<TValue>::max());
+  }
+
+  // Adds a coverage delta, a position whose summed delta leaves the range of the signed counter keeps it in the overflow list
+  template<typename TValue>
+  inline void
+  _addDelta(DenseTrack<TValue>& cov, uint32_t const pos, int64_t const delta) {
+    typedef typename boost::make_signed<TValue>::type TDelta;
+    int64_t val = (int64_t) (TDelta) cov.data[pos] + delta;
+    if ((val < std::numeric_limits<TDelta>::min()) || (val > std::numeric_limits<TDelta>::max())) {
+      cov.overflow.push_back(std::make_pair(pos, val));
+      cov.data[pos] = 0;
+    }
+    else cov.data[pos] = (TValue) (TDelta) val;
+  }
+
+  template<typename TValue>
+  inline void
+  addCoverage(DenseTrack<TValue>& cov, uint32_t const start, uint32_t const oplen, uint32_t const w) {
+    // Difference array, deltas are stored as signed values of the counter width
+    _addDelta(cov, start, w);
+    if (start + oplen < cov.data.size()) _addDelta(cov, start + oplen, -((int64_t) w));
+  }
+
+  template<typename TValue>
+  inline void
+  flushCoverage(DenseTrack<TValue>&, uint32_t const) {}
+
+  template<typename TValue>
+  inline bool
+  finishClips(std::vector<TValue>&) {
+    return false;
+  }
+
+  // Returns true if the coverage exceeds the counter width somewhere
+  template<typename TValue>
+  inline bool
+  finishCoverage(DenseTrack<TValue>& cov, uint32_t const spanStart, uint32_t const spanEnd) {
+    // Saturating prefix pass over the difference array and the overflowed deltas
+    // All deltas lie within [spanStart, spanEnd) of the parsed reads, the track is zero outside of it
+    typedef typename boost::make_signed<TValue>::type TDelta;
+    std::vector<TValue>& data = cov.data;
+    uint32_t end = std::min(spanEnd, (uint32_t) data.size());
+    uint32_t start = std::min(spanStart, end);
+    cov.touched(start, end);
+    std::sort(cov.overflow.begin(), cov.overflow.end());
+    int64_t maxval = std::numeric_limits<TValue>::max();
+    int64_t running = 0;
+    bool saturated = false;
+    uint32_t k = 0;
+    for(uint32_t i = start; i < end; ++i) {
+      running += (TDelta) data[i];
+      for(; (k < cov.overflow.size()) && (cov.overflow[k].first == i); ++k) running += cov.overflow[k].second;
+      if (running > maxval) saturated = true;
+      data[i] = (running < maxval) ? running : maxval;
+    }
+    cov.overflow.clear();
+    return saturated;
+  }
+
+  // Split-read support and at most contam * support clips in the control
+  template<typename TValue>
+  inline bool
+  clipPass(TValue const clip, TValue const cclip, uint32_t const minSplit, float const contam) {
+    return ((clip >= minSplit) && (cclip <= (uint32_t) (contam * clip)));
+  }
+
+  // Any position in [0, n) with left or right clips >= minSplit, the build disables tree vectorization globally but not here
+  template<typename TValue>
+  __attribute__((optimize("tree-vectorize")))
+  inline bool
+  anyClip(TValue const* left, TValue const* right, uint32_t const n, uint32_t const minSplit) {
+    uint32_t hit = 0;
+    for(uint32_t j = 0; j < n; ++j) hit |= ((left[j] >= minSplit) | (right[j] >= minSplit));
+    return hit;
+  }
+
+#ifdef RAYAS_X86_DISPATCH
+  __attribute__((target("avx2")))
+  inline bool
+  anyClipAvx2(uint16_t const* left, uint16_t const* right, uint32_t const n, uint16_t const minSplit) {
+    // Unsigned x >= minSplit iff max(x, minSplit) == x
+    __m256i m = _mm256_set1_epi16(minSplit);
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t j = 0;
+    for(; j + 16 <= n; j += 16) {
+      __m256i l = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(left + j));
+      __m256i r = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(right + j));
+      acc = _mm256_or_si256(acc, _mm256_cmpeq_epi16(_mm256_max_epu16(l, m), l));
+      acc = _mm256_or_si256(acc, _mm256_cmpeq_epi16(_mm256_max_epu16(r, m), r));
+    }
+    if (!_mm256_testz_si256(acc, acc)) return true;
+    for(; j < n; ++j) {
+      if ((left[j] >= minSplit) || (right[j] >= minSplit)) return true;
+    }
+    return false;
+  }
+
+  __attribute__((target("avx2")))
+  inline bool
+  anyClipAvx2(uint8_t const* left, uint8_t const* right, uint32_t const n, uint8_t const minSplit) {
+    __m256i m = _mm256_set1_epi8(minSplit);
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t j = 0;
+    for(; j + 32 <= n; j += 32) {
+      __m256i l = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(left + j));
+      __m256i r = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(right + j));
+      acc = _mm256_or_si256(acc, _mm256_cmpeq_epi8(_mm256_max_epu8(l, m), l));
+      acc = _mm256_or_si256(acc, _mm256_cmpeq_epi8(_mm256_max_epu8(r, m), r));
+    }
+    if (!_mm256_testz_si256(acc, acc)) return true;
+    for(; j < n; ++j) {
+      if ((left[j] >= minSplit) || (right[j] >= minSplit)) return true;
+    }
+    return false;
+  }
+
+  inline bool
+  anyClip(uint16_t const* left, uint16_t const* right, uint32_t const n, uint32_t const minSplit) {
+    static bool const avx2 = __builtin_cpu_supports("avx2");
+    if ((avx2) && (minSplit <= std::numeric_limits<uint16_t>::max())) return anyClipAvx2(left, right, n, minSplit);
+    return anyClip<uint16_t>(left, right, n, minSplit);
+  }
+
+  inline bool
+  anyClip(uint8_t const* left, uint8_t const* right, uint32_t const n, uint32_t const minSplit) {
+    static bool const avx2 = __builtin_cpu_supports("avx2");
+    if ((avx2) && (minSplit <= std::numeric_limits<uint8_t>::max())) return anyClipAvx2(left, right, n, minSplit);
+    return anyClip<uint8_t>(left, right, n, minSplit);
+  }
+#endif
+
+  template<typename TValue>
+  inline void
+  clipCandidates(std::vector<TValue> const& left, std::vector<TValue> const& right, std::vector<TValue> const& cleft, std::vector<TValue> const& cright, uint32_t const minSplit, float const contam, uint32_t const start, uint32_t const end, std::vector<uint32_t>& cand) {
+    // Almost all positions lack clips, whole blocks are skipped before the exact test
+    uint32_t const block = 256;
+    for(uint32_t b = start; b < end; b += block) {
+      uint32_t n = std::min(block, end - b);
+      if (!anyClip(&left[b], &right[b], n, minSplit)) continue;
+      for(uint32_t i = b; i < b + n; ++i) {
+	if ((clipPass(left[i], cleft[i], minSplit, contam)) || (clipPass(right[i], cright[i], minSplit, contam))) cand.push_back(i);
+      }
+    }
+  }
+
+
+  // Compact storage, counts saturate when they are collapsed by finishClips
+  template<typename TValue>
+  inline bool
+  addClip(SparseCounts<TValue>& clips, uint32_t const pos, uint32_t const w) {
+    clips.increment(pos, w);
+    return false;
+  }
+
+  template<typename TValue>
+  inline void
+  addCoverage(CompactCoverage<TValue>& cov, uint32_t const start, uint32_t const oplen, uint32_t const w) {
+    cov.add(start, oplen, w);
+  }
+
+  template<typename TValue>
+  inline void
+  flushCoverage(CompactCoverage<TValue>& cov, uint32_t const pos) {
+    cov.flush(pos);
+  }
+
+  template<typename TValue>
+  inline bool
+  finishClips(SparseCounts<TValue>& clips) {
+    return clips.finish();
+  }
+
+  template<typename TValue>
+  inline bool
+  finishCoverage(CompactCoverage<TValue>& cov, uint32_t const, uint32_t const) {
+    cov.finish();
+    return cov.saturated;
+  }
+
+  template<typename TValue>
+  inline void
+  clipCandidates(SparseCounts<TValue> const& left, SparseCounts<TValue> const& right, SparseCounts<TValue> const& cleft, SparseCounts<TValue> const& cright, uint32_t const minSplit, float const contam, uint32_t const start, uint32_t const end, std::vector<uint32_t>& cand) {
+    // Merge both sorted lists
+    uint32_t i = 0;
+    uint32_t j = 0;
+    while ((i < left.entries.size()) || (j < right.entries.size())) {
+      uint32_t pos = 0;
+      TValue lval = 0;
+      TValue rval = 0;
+      if ((j == right.entries.size()) || ((i < left.entries.size()) && (left.entries[i].first <= right.entries[j].first))) pos = left.entries[i].first;
+      else pos = right.entries[j].first;
+      if ((i < left.entries.size()) && (left.entries[i].first == pos)) lval = left.entries[i++].second;
+      if ((j < right.entries.size()) && (right.entries[j].first == pos)) rval = right.entries[j++].second;
+      if ((pos >= start) && (pos < end) && ((clipPass(lval, cleft[pos], minSplit, contam)) || (clipPass(rval, cright[pos], minSplit, contam)))) cand.push_back(pos);
+    }
+  }
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <queue>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+
+namespace rayas
+{
+
+  // Split-read seed and the region-local segment it maps to
+  struct SplitRead {
+    ReadId id;
+    uint32_t region;
+    uint32_t segment;
+
+    SplitRead() : id(), region(0), segment(0) {}
+    SplitRead(ReadId const& h, uint32_t const r, uint32_t const s) : id(h), region(r), segment(s) {}
+
+    inline bool operator<(SplitRead const& other) const {
+      return ((id < other.id) || ((id == other.id) && ((region < other.region) || ((region == other.region) && (segment < other.segment)))));
+    }
+  };
+
+
+  // Sorts records in memory up to a limit, beyond that sorted runs are spilled to temporary files and merge-streamed
+  // A failed spill or a truncated run clears good, next then ends early and the caller has to check good
+  template<typename TRecord>
+  struct ExternalSorter {
+    typedef TRecord value_type;
+    typedef std::pair<TRecord, uint32_t> THead;
+
+    bool good;
+    std::size_t maxRecords;
+    std::size_t count;
+    boost::filesystem::path tmpdir;
+    std::vector<TRecord> buffer;
+    std::vector<boost::filesystem::path> runs;
+
+    // Streaming state
+    std::size_t pos;
+    std::size_t chunk;
+    std::vector<std::ifstream*> ifs;
+    std::vector<std::vector<TRecord> > inbuf;
+    std::vector<std::size_t> inpos;
+    std::priority_queue<THead, std::vector<THead>, std::greater<THead> > heads;
+
+    ExternalSorter(std::size_t const maxmem, boost::filesystem::path const& dir) : good(true), maxRecords(std::max(maxmem / sizeof(TRecord), (std::size_t) 1024)), count(0), tmpdir(dir), pos(0), chunk(0) {}
+
+    ~ExternalSorter() {
+      for(uint32_t i = 0; i < ifs.size(); ++i) {
+	ifs[i]->close();
+	delete ifs[i];
+      }
+      for(uint32_t i = 0; i < runs.size(); ++i) boost::filesystem::remove(runs[i]);
+    }
+
+    inline void
+    push(TRecord const& rec) {
+      buffer.push_back(rec);
+      ++count;
+      if (buffer.size() >= maxRecords) _spill();
+    }
+
+    inline std::size_t
+    size() const {
+      return count;
+    }
+
+    inline std::size_t
+    spilled() const {
+      return runs.size();
+    }
+
+    // Call once after the last push, afterwards records are returned in sorted order by next
+    inline void
+    finish() {
+      if (runs.empty()) {
+	std::sort(buffer.begin(), buffer.end());
+	pos = 0;
+	return;
+      }
+      if (!buffer.empty()) _spill();
+      std::vector<TRecord>().swap(buffer);
+      chunk = std::max(maxRecords / (runs.size() + 1), (std::size_t) 1024);
+      inbuf.resize(runs.size());
+      inpos.resize(runs.size(), 0);
+      for(uint32_t i = 0; i < runs.size(); ++i) {
+	ifs.push_back(new std::ifstream(runs[i].string().c_str(), std::ios::in | std::ios::binary));
+	if (!ifs[i]->is_open()) good = false;
+	else if (_fill(i)) heads.push(std::make_pair(inbuf[i][0], i));
+      }
+    }
+
+    inline bool
+    next(TRecord& rec) {
+      if (runs.empty()) {
+	if (pos >= buffer.size()) return false;
+	rec = buffer[pos++];
+	return true;
+      }
+      if ((!good) || (heads.empty())) return false;
+      THead top = heads.top();
+      heads.pop();
+      rec = top.first;
+      uint32_t r = top.second;
+      if ((++inpos[r] < inbuf[r].size()) || (_fill(r))) heads.push(std::make_pair(inbuf[r][inpos[r]], r));
+      return true;
+    }
+
+    inline void
+    _spill() {
+      std::sort(buffer.begin(), buffer.end());
+      boost::filesystem::path run = tmpdir / boost::filesystem::unique_path("rayas-%%%%-%%%%-%%%%-%%%%.run");
+      std::ofstream ofs(run.string().c_str(), std::ios::out | std::ios::binary);
+      ofs.write(reinterpret_cast<char const*>(&buffer[0]), buffer.size() * sizeof(TRecord));
+      if (!ofs.good()) good = false;
+      ofs.close();
+      if (!ofs) good = false;
+      runs.push_back(run);
+      buffer.clear();
+    }
+
+    // Returns false at the end of a run, a read error or a partial record at the end also clears good
+    inline bool
+    _fill(uint32_t const r) {
+      inbuf[r].resize(chunk);
+      ifs[r]->read(reinterpret_cast<char*>(&inbuf[r][0]), chunk * sizeof(TRecord));
+      std::streamsize bytes = ifs[r]->gcount();
+      if ((ifs[r]->bad()) || (bytes % sizeof(TRecord))) {
+	good = false;
+	inbuf[r].clear();
+	return false;
+      }
+      inbuf[r].resize(bytes / sizeof(TRecord));
+      inpos[r] = 0;
+      return (!inbuf[r].empty());
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef MASK_H
+#define MASK_H
+
+#include <map>
+#include <fstream>
+#include <sstream>
+
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+namespace rayas
+{
+
+  struct MaskConfig {
+    boost::filesystem::path genome;
+    boost::filesystem::path outfile;
+  };
+
+  // N-runs of a reference genome as sorted, half-open intervals per contig
+  struct NRuns {
+    typedef std::vector<std::pair<uint32_t, uint32_t> > TIntervals;
+    typedef std::map<std::string, TIntervals> TContigIntervals;
+
+    uint64_t checksum;
+    TContigIntervals contigs;
+
+    NRuns() : checksum(0) {}
+
+    // Appends all N-runs overlapping [start, end) relative to start
+    inline void
+    overlapping(std::string const& chrName, uint32_t const start, uint32_t const end, TIntervals& out) const {
+      TContigIntervals::const_iterator ci = contigs.find(chrName);
+      if (ci == contigs.end()) return;
+      TIntervals const& iv = ci->second;
+      TIntervals::const_iterator it = std::upper_bound(iv.begin(), iv.end(), std::make_pair(start, std::numeric_limits<uint32_t>::max()));
+      if (it != iv.begin()) --it;
+      for(; (it != iv.end()) && (it->first < end); ++it) {
+	if (it->second <= start) continue;
+	out.push_back(std::make_pair(std::max(it->first, start) - start, std::min(it->second, end) - start));
+      }
+    }
+  };
+
+  static char const maskMagic[8] = {'R', 'A', 'Y', 'A', 'S', 'N', 'M', 'K'};
+  static uint32_t const maskVersion = 1;
+
+  inline boost::filesystem::path
+  defaultMaskPath(boost::filesystem::path const& genome) {
+    return boost::filesystem::path(genome.string() + ".nmask");
+  }
+
+  // Mask files are keyed by the checksum of the FASTA index, returns 0 if there is no index
+  inline uint64_t
+  faiChecksum(boost::filesystem::path const& genome) {
+    return fileDigest(genome.string() + ".fai");
+  }
+
+  inline bool
+  writeNRuns(boost::filesystem::path const& path, NRuns const& nr) {
+    std::ofstream ofs(path.string().c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open()) return false;
+    ofs.write(maskMagic, 8);
+    ofs.write(reinterpret_cast<char const*>(&maskVersion), sizeof(uint32_t));
+    ofs.write(reinterpret_cast<char const*>(&nr.checksum), sizeof(uint64_t));
+    uint32_t n = nr.contigs.size();
+    ofs.write(reinterpret_cast<char const*>(&n), sizeof(uint32_t));
+    for(NRuns::TContigIntervals::const_iterator it = nr.contigs.begin(); it != nr.contigs.end(); ++it) {
+      uint32_t nameLen = it->first.size();
+      ofs.write(reinterpret_cast<char const*>(&nameLen), sizeof(uint32_t));
+      ofs.write(it->first.c_str(), nameLen);
+      uint64_t nint = it->second.size();
+      ofs.write(reinterpret_cast<char const*>(&nint), sizeof(uint64_t));
+      for(uint64_t i = 0; i < nint; ++i) {
+	ofs.write(reinterpret_cast<char const*>(&it->second[i].first), sizeof(uint32_t));
+	ofs.write(reinterpret_cast<char const*>(&it->second[i].second), sizeof(uint32_t));
+      }
+    }
+    ofs.close();
+    return ofs.good();
+  }
+
+  // Contig lengths of the FASTA index
+  inline bool
+  faiLengths(boost::filesystem::path const& genome, std::map<std::string, uint32_t>& chrLen) {
+    std::ifstream ifs((genome.string() + ".fai").c_str(), std::ios::in);
+    if (!ifs.is_open()) return false;
+    std::string line;
+    while (std::getline(ifs, line)) {
+      std::vector<std::string> fields;
+      boost::split(fields, line, boost::is_any_of("\t"));
+      if (fields.size() < 2) return false;
+      try {
+	chrLen[fields[0]] = boost::lexical_cast<uint32_t>(fields[1]);
+      } catch (boost::bad_lexical_cast const&) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  // Reference index checksum of a mask file, 0 if it is missing or not a mask
+  inline uint64_t
+  maskChecksum(boost::filesystem::path const& path) {
+    std::ifstream ifs(path.string().c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) return 0;
+    char magic[8];
+    uint32_t version = 0;
+    uint64_t checksum = 0;
+    ifs.read(magic, 8);
+    ifs.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    ifs.read(reinterpret_cast<char*>(&checksum), sizeof(uint64_t));
+    if ((!ifs.good()) || (!std::equal(magic, magic + 8, maskMagic)) || (version != maskVersion)) return 0;
+    return checksum;
+  }
+
+  // Fails if the file is missing, damaged or was built for a different reference index
+  // Contigs need to be in the index, runs sorted, disjoint and within the contig, so a damaged file never allocates more than the contig lengths allow
+  inline bool
+  readNRuns(boost::filesystem::path const& path, uint64_t const checksum, std::map<std::string, uint32_t> const& chrLen, NRuns& nr) {
+    std::ifstream ifs(path.string().c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) return false;
+    char magic[8];
+    uint32_t version = 0;
+    ifs.read(magic, 8);
+    ifs.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    ifs.read(reinterpret_cast<char*>(&nr.checksum), sizeof(uint64_t));
+    if ((!ifs.good()) || (!std::equal(magic, magic + 8, maskMagic)) || (version != maskVersion) || (nr.checksum != checksum)) return false;
+    std::size_t maxNameLen = 0;
+    for(std::map<std::string, uint32_t>::const_iterator it = chrLen.begin(); it != chrLen.end(); ++it) maxNameLen = std::max(maxNameLen, it->first.size());
+    uint32_t n = 0;
+    ifs.read(reinterpret_cast<char*>(&n), sizeof(uint32_t));
+    if ((!ifs.good()) || (n > chrLen.size())) return false;
+    for(uint32_t k = 0; k < n; ++k) {
+      uint32_t nameLen = 0;
+      ifs.read(reinterpret_cast<char*>(&nameLen), sizeof(uint32_t));
+      if ((!ifs.good()) || (nameLen > maxNameLen)) return false;
+      std::string name(nameLen, ' ');
+      if (nameLen) ifs.read(&name[0], nameLen);
+      std::map<std::string, uint32_t>::const_iterator cl = chrLen.find(name);
+      if ((!ifs.good()) || (cl == chrLen.end()) || (nr.contigs.find(name) != nr.contigs.end())) return false;
+      // Adjacent runs are joined, so there are at most (len + 1) / 2 runs
+      uint64_t nint = 0;
+      ifs.read(reinterpret_cast<char*>(&nint), sizeof(uint64_t));
+      if ((!ifs.good()) || (nint > ((uint64_t) cl->second + 1) / 2)) return false;
+      NRuns::TIntervals& iv = nr.contigs[name];
+      iv.resize(nint);
+      uint32_t lastEnd = 0;
+      for(uint64_t i = 0; i < nint; ++i) {
+	ifs.read(reinterpret_cast<char*>(&iv[i].first), sizeof(uint32_t));
+	ifs.read(reinterpret_cast<char*>(&iv[i].second), sizeof(uint32_t));
+	if ((!ifs.good()) || (iv[i].first < lastEnd) || (iv[i].first >= iv[i].second) || (iv[i].second > cl->second)) return false;
+	lastEnd = iv[i].second;
+      }
+    }
+    return ifs.good();
+  }
+
+  template<typename TConfig>
+  inline int32_t
+  runMask(TConfig& c) {
+    NRuns nr;
+    nr.checksum = faiChecksum(c.genome);
+    if (!nr.checksum) {
+      std::cerr << "Error: FASTA index " << c.genome.string() << ".fai is missing, run samtools faidx" << std::endl;
+      return 1;
+    }
+    faidx_t* fai = fai_load(c.genome.string().c_str());
+    if (fai == NULL) {
+      std::cerr << "Error: Genome " << c.genome.string() << " cannot be loaded" << std::endl;
+      return 1;
+    }
+    for(int32_t refIndex = 0; refIndex < faidx_nseq(fai); ++refIndex) {
+      std::string chrName(faidx_iseq(fai, refIndex));
+      boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+      std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Scanning " << chrName << std::endl;
+      int32_t seqlen = -1;
+      char* seq = faidx_fetch_seq(fai, chrName.c_str(), 0, faidx_seq_len(fai, chrName.c_str()) - 1, &seqlen);
+      NRuns::TIntervals& iv = nr.contigs[chrName];
+      for(int32_t i = 0; i < seqlen; ++i) {
+	if ((seq[i] == 'n') || (seq[i] == 'N')) {
+	  if ((!iv.empty()) && (iv.back().second == (uint32_t) i)) ++iv.back().second;
+	  else iv.push_back(std::make_pair(i, i + 1));
+	}
+      }
+      if (seq != NULL) free(seq);
+    }
+    fai_destroy(fai);
+    if (!writeNRuns(c.outfile, nr)) {
+      std::cerr << "Error: N-mask " << c.outfile.string() << " could not be written" << std::endl;
+      return 1;
+    }
+
+    // End
+    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+    std::cout << '[' << boost::posix_time::to_simple_string(now) << "] Done." << std::endl;
+    return 0;
+  }
+
+
+  int mask(int argc, char** argv) {
+    MaskConfig c;
+
+    // Parameter
+    boost::program_options::options_description generic("Options");
+    generic.add_options()
+      ("help,?", "show help message")
+      ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile), "N-mask output file [default: <genome.fa>.nmask]")
+      ;
+
+    boost::program_options::options_description hidden("Hidden options");
+    hidden.add_options()
+      ("input-file", boost::program_options::value<boost::filesystem::path>(&c.genome), "genome fasta file")
+      ;
+
+    boost::program_options::positional_options_description pos_args;
+    pos_args.add("input-file", -1);
+
+    // Set the visibility
+    boost::program_options::options_description cmdline_options;
+    cmdline_options.add(generic).add(hidden);
+    boost::program_options::options_description visible_options;
+    visible_options.add(generic);
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(cmdline_options).positional(pos_args).run(), vm);
+    boost::program_options::notify(vm);
+
+    // Check command line arguments
+    if ((vm.count("help")) || (!vm.count("input-file"))) {
+      std::cout << "Usage: rayas " << argv[0] << " [OPTIONS] <genome.fa>" << std::endl;
+      std::cout << visible_options << "\n";
+      return -1;
+    }
+    if (!vm.count("outfile")) c.outfile = defaultMaskPath(c.genome);
+
+    // Show cmd
+    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+    std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
+    std::cout << "rayas ";
+    for(int i=0; i<argc; ++i) { std::cout << argv[i] << ' '; }
+    std::cout << std::endl;
+
+    return runMask(c);
+  }
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <fstream>
+
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+namespace rayas
+{
+
+  struct MergeConfig {
+    bool hasMinSplit;
+    bool hasMinSegDist;
+    uint16_t minSplit;
+    uint32_t minSegDist;
+    uint32_t linkmem;
+    boost::filesystem::path outfile;
+    boost::filesystem::path graph;
+    boost::filesystem::path tmpdir;
+    std::vector<boost::filesystem::path> files;
+  };
+
+  // Region record of a partial file
+  struct PartialRegion {
+    int32_t tid;
+    uint32_t start;
+    uint32_t end;
+    uint32_t file;
+    std::streampos reads;
+    std::string chrName;
+    std::vector<Segment> sgm;
+  };
+
+  template<typename TPartialRegion>
+  struct SortPartialRegions {
+    inline bool operator()(TPartialRegion const& r1, TPartialRegion const& r2) const {
+      return ((r1.tid < r2.tid) || ((r1.tid == r2.tid) && (r1.start < r2.start)));
+    }
+  };
+
+
+  template<typename TConfig>
+  inline int32_t
+  runMerge(TConfig& c) {
+    typedef std::vector<Segment> TSegments;
+    typedef std::pair<ReadId, uint32_t> TReadPos;
+    typedef std::vector<TReadPos> TChrReadPos;
+
+    // Collect region records, split-reads are streamed in a second pass
+    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+    std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Reading partial files" << std::endl;
+    std::vector<PartialRegion> regions;
+    uint64_t fingerprint = 0;
+    for(uint32_t f = 0; f < c.files.size(); ++f) {
+      std::ifstream ifs(c.files[f].string().c_str(), std::ios::in | std::ios::binary);
+      if (!ifs.is_open()) {
+	std::cerr << "Error: Partial file " << c.files[f].string() << " cannot be opened" << std::endl;
+	return 1;
+      }
+      while (ifs.peek() != EOF) {
+	RecordHeader rh;
+	PartialRegion pr;
+	if (!readRecordHeader(ifs, rh)) {
+	  std::cerr << "Error: " << c.files[f].string() << " is not a valid partial file" << std::endl;
+	  return 1;
+	}
+	if ((!regions.empty()) && (rh.fingerprint != fingerprint)) {
+	  std::cerr << "Error: " << c.files[f].string() << " was generated with different parameters or input files" << std::endl;
+	  return 1;
+	}
+	fingerprint = rh.fingerprint;
+	if (regions.empty()) {
+	  // Linking thresholds of the partial runs, command-line values must agree
+	  if ((c.hasMinSplit) && (c.minSplit != rh.minSplit)) {
+	    std::cerr << "Error: Min. split-read support " << c.minSplit << " differs from " << rh.minSplit << " in " << c.files[f].string() << std::endl;
+	    return 1;
+	  }
+	  if ((c.hasMinSegDist) && (c.minSegDist != rh.minSegDist)) {
+	    std::cerr << "Error: Min. segment distance " << c.minSegDist << " differs from " << rh.minSegDist << " in " << c.files[f].string() << std::endl;
+	    return 1;
+	  }
+	  c.minSplit = rh.minSplit;
+	  c.minSegDist = rh.minSegDist;
+	}
+	pr.tid = rh.refIndex;
+	pr.start = rh.start;
+	pr.end = rh.end;
+	pr.file = f;
+	pr.chrName = rh.chrName;
+	if (!readRecordSegments(ifs, rh.refIndex, pr.sgm)) {
+	  std::cerr << "Error: " << c.files[f].string() << " is truncated" << std::endl;
+	  return 1;
+	}
+	pr.reads = ifs.tellg();
+	if (!skipRecordReads(ifs)) {
+	  std::cerr << "Error: " << c.files[f].string() << " is truncated" << std::endl;
+	  return 1;
+	}
+	regions.push_back(pr);
+      }
+    }
+
+    // Genomic order, as in a single rayas call run
+    std::sort(regions.begin(), regions.end(), SortPartialRegions<PartialRegion>());
+    std::vector<std::string> chrNames;
+    for(uint32_t ri = 0; ri < regions.size(); ++ri) {
+      if ((ri > 0) && (regions[ri].tid == regions[ri-1].tid) && (regions[ri].start < regions[ri-1].end)) {
+	std::cerr << "Error: Region " << regions[ri].chrName << ':' << regions[ri].start + 1 << '-' << regions[ri].end << " is present in more than one partial file" << std::endl;
+	return 1;
+      }
+      if ((int32_t) chrNames.size() <= regions[ri].tid) chrNames.resize(regions[ri].tid + 1);
+      chrNames[regions[ri].tid] = regions[ri].chrName;
+    }
+
+    // Split-reads
+    uint64_t linkmem = (uint64_t) c.linkmem * 1024 * 1024;
+    ExternalSorter<SplitRead> splitReads1(linkmem / 2, c.tmpdir);
+    ExternalSorter<SplitRead> splitReads2(linkmem / 2, c.tmpdir);
+    std::vector<TSegments> regionSgm(regions.size());
+    for(uint32_t ri = 0; ri < regions.size(); ++ri) {
+      std::ifstream ifs(c.files[regions[ri].file].string().c_str(), std::ios::in | std::ios::binary);
+      ifs.seekg(regions[ri].reads);
+      TChrReadPos readSeg1;
+      TChrReadPos readSeg2;
+      if (!readRecordReads(ifs, readSeg1, readSeg2)) {
+	std::cerr << "Error: " << c.files[regions[ri].file].string() << " is truncated" << std::endl;
+	return 1;
+      }
+      for(uint32_t i = 0; i < readSeg1.size(); ++i) splitReads1.push(SplitRead(readSeg1[i].first, ri, readSeg1[i].second));
+      for(uint32_t i = 0; i < readSeg2.size(); ++i) splitReads2.push(SplitRead(readSeg2[i].first, ri, readSeg2[i].second));
+      regionSgm[ri].swap(regions[ri].sgm);
+    }
+    CallStats stats;
+    if (!linkSegments(c, chrNames, regionSgm, splitReads1, splitReads2, c.outfile, c.graph, stats)) return 1;
+
+    // End
+    now = boost::posix_time::second_clock::local_time();
+    std::cout << '[' << boost::posix_time::to_simple_string(now) << "] Done." << std::endl;
+    return 0;
+  }
+
+
+  int merge(int argc, char** argv) {
+    MergeConfig c;
+
+    // Parameter
+    boost::program_options::options_description generic("Options");
+    generic.add_options()
+      ("help,?", "show help message")
+      ("split,s", boost::program_options::value<uint16_t>(&c.minSplit)->default_value(3), "min. split-read support, must match the partial files")
+      ("minsegdist,e", boost::program_options::value<uint32_t>(&c.minSegDist)->default_value(10000), "min. distance between segments, must match the partial files")
+      ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile)->default_value("out.bed"), "BED output file, tabix-indexed if it ends in .gz")
+      ("graph", boost::program_options::value<boost::filesystem::path>(&c.graph)->default_value(""), "segment graph output, GFA for .gfa or an edge list otherwise")
+      ("linkmem", boost::program_options::value<uint32_t>(&c.linkmem)->default_value(1024), "max. memory in MB for split-reads before spilling to disk")
+      ("tmpdir", boost::program_options::value<boost::filesystem::path>(&c.tmpdir)->default_value(boost::filesystem::temp_directory_path()), "directory for temporary files")
+      ;
+
+    boost::program_options::options_description hidden("Hidden options");
+    hidden.add_options()
+      ("input-file", boost::program_options::value<std::vector<boost::filesystem::path> >(&c.files), "input partial files")
+      ;
+
+    boost::program_options::positional_options_description pos_args;
+    pos_args.add("input-file", -1);
+
+    // Set the visibility
+    boost::program_options::options_description cmdline_options;
+    cmdline_options.add(generic).add(hidden);
+    boost::program_options::options_description visible_options;
+    visible_options.add(generic);
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(cmdline_options).positional(pos_args).run(), vm);
+    boost::program_options::notify(vm);
+
+    // Check command line arguments
+    if ((vm.count("help")) || (!vm.count("input-file"))) {
+      std::cout << "Usage: rayas " << argv[0] << " [OPTIONS] <chr1.bin> <chr2.bin> ..." << std::endl;
+      std::cout << visible_options << "\n";
+      return -1;
+    }
+
+    // Thresholds are taken from the partial files unless given explicitly
+    c.hasMinSplit = (!vm["split"].defaulted());
+    c.hasMinSegDist = (!vm["minsegdist"].defaulted());
+
+    // Show cmd
+    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+    std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
+    std::cout << "rayas ";
+    for(int i=0; i<argc; ++i) { std::cout << argv[i] << ' '; }
+    std::cout << std::endl;
+
+    return runMerge(c);
+  }
+
+}
+
+#endif
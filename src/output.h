@@ -0,0 +1,105 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <string>
+#include <sstream>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include <htslib/bgzf.h>
+#include <htslib/tbx.h>
+
+namespace rayas
+{
+
+  // Output files ending in .gz are BGZF-compressed
+  inline bool
+  compressedPath(boost::filesystem::path const& path) {
+    return (path.extension().string() == ".gz");
+  }
+
+  // Path without a trailing .gz, its extension names the format
+  inline boost::filesystem::path
+  plainPath(boost::filesystem::path const& path) {
+    if (compressedPath(path)) return path.parent_path() / path.stem();
+    return path;
+  }
+
+  // Per-sample output file, the sample name goes before the format extension, e.g. out.bed.gz becomes out.<name>.bed.gz
+  inline boost::filesystem::path
+  samplePath(boost::filesystem::path const& path, std::string const& name) {
+    boost::filesystem::path plain = plainPath(path);
+    std::string file = plain.stem().string() + "." + name + plain.extension().string();
+    if (compressedPath(path)) file += ".gz";
+    return path.parent_path() / file;
+  }
+
+  // Text output collected in blocks of about 1MB, written plain or BGZF-compressed
+  struct OutputWriter {
+    BGZF* bgzf;
+    std::ofstream ofs;
+    std::ostringstream buf;
+    bool good;
+
+    OutputWriter() : bgzf(NULL), good(false) {}
+
+    inline bool
+    open(boost::filesystem::path const& path) {
+      if (compressedPath(path)) good = ((bgzf = bgzf_open(path.string().c_str(), "w")) != NULL);
+      else {
+	ofs.open(path.string().c_str(), std::ios::out | std::ios::binary);
+	good = ofs.is_open();
+      }
+      return good;
+    }
+
+    template<typename TValue>
+    inline OutputWriter&
+    operator<<(TValue const& val) {
+      buf << val;
+      return *this;
+    }
+
+    // Ends a line, no flush unless the block is full
+    inline void
+    endl() {
+      buf << '\n';
+      if (buf.tellp() >= (std::streamoff) (1 << 20)) _spill();
+    }
+
+    inline bool
+    close() {
+      _spill();
+      if (bgzf != NULL) {
+	if (bgzf_close(bgzf) != 0) good = false;
+	bgzf = NULL;
+      } else if (ofs.is_open()) {
+	ofs.close();
+	if (!ofs) good = false;
+      }
+      return good;
+    }
+
+    inline void
+    _spill() {
+      std::string const& str = buf.str();
+      if (str.empty()) return;
+      if (bgzf != NULL) {
+	if (bgzf_write(bgzf, str.c_str(), str.size()) != (ssize_t) str.size()) good = false;
+      } else ofs.write(str.c_str(), str.size());
+      buf.str(std::string());
+    }
+  };
+
+  // Tabix index of a BGZF-compressed BED file with one header line
+  inline bool
+  indexBed(boost::filesystem::path const& path) {
+    tbx_conf_t conf = tbx_conf_bed;
+    conf.line_skip = 1;
+    return (tbx_index_build(path.string().c_str(), 0, &conf) == 0);
+  }
+
+}
+
+#endif
@@ -5,13 +5,25 @@
 
 #define BOOST_DISABLE_ASSERTS
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 #ifdef PROFILE
 #include "gperftools/profiler.h"
 #endif
 
 #include "util.h"
 #include "version.h"
+#include "stats.h"
+#include "coverage.h"
+#include "extsort.h"
+#include "checkpoint.h"
+#include "tracks.h"
+#include "output.h"
+#include "mask.h"
 #include "call.h"
+#include "merge.h"
 
 using namespace rayas;
 
@@ -22,6 +34,8 @@ displayUsage() {
   std::cout << "Commands:" << std::endl;
   std::cout << std::endl;
   std::cout << "    call     discover templated insertion threads" << std::endl;
+  std::cout << "    merge    link and output partial files of per-chromosome call runs" << std::endl;
+  std::cout << "    mask     precompute the N-mask of a reference genome" << std::endl;
   std::cout << std::endl;
   std::cout << std::endl;
 }
@@ -54,6 +68,12 @@ int main(int argc, char **argv) {
   }
   else if ((std::string(argv[1]) == "call")) {
     return call(argc-1,argv+1);
+  }
+  else if ((std::string(argv[1]) == "merge")) {
+    return merge(argc-1,argv+1);
+  }
+  else if ((std::string(argv[1]) == "mask")) {
+    return mask(argc-1,argv+1);
   } else {
     std::cerr << "Unrecognized command " << std::string(argv[1]) << std::endl;
     return 1;
@@ -0,0 +1,261 @@
+#define _SECURE_SCL 0
+#define _SCL_SECURE_NO_WARNINGS
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#define BOOST_DISABLE_ASSERTS
+
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <htslib/sam.h>
+#include <htslib/faidx.h>
+
+// Synthetic reference, matched control and tumor with planted templated insertion threads for benchmarking
+
+struct SimConfig {
+  uint32_t seed;
+  uint32_t nchr;
+  uint32_t chrlen;
+  uint32_t depth;
+  uint32_t ampdepth;
+  uint32_t segments;
+  uint32_t threadlen;
+  uint32_t support;
+  uint32_t readlen;
+  boost::filesystem::path outdir;
+};
+
+struct SimSegment {
+  int32_t tid;
+  uint32_t start;
+  uint32_t end;
+  uint32_t thread;
+};
+
+struct SimRead {
+  int32_t tid;
+  uint32_t pos;
+  uint16_t flag;
+  uint32_t name;
+  uint32_t clip;  // Soft- or hard-clipped bases, 0 for full-length matches
+  uint8_t layout;  // 0: M, 1: xM yS, 2: xS yM, 3: xH yM
+
+  SimRead(int32_t const t, uint32_t const p, uint16_t const f, uint32_t const n, uint32_t const c, uint8_t const l) : tid(t), pos(p), flag(f), name(n), clip(c), layout(l) {}
+
+  inline bool operator<(SimRead const& other) const {
+    return ((tid < other.tid) || ((tid == other.tid) && ((pos < other.pos) || ((pos == other.pos) && (name < other.name)))));
+  }
+};
+
+typedef boost::random::mt19937 TRng;
+
+inline uint32_t
+uniform(TRng& rng, uint32_t const lo, uint32_t const hi) {
+  boost::random::uniform_int_distribution<uint32_t> dist(lo, hi);
+  return dist(rng);
+}
+
+inline std::string
+chrName(uint32_t const tid) {
+  return "sim" + boost::lexical_cast<std::string>(tid + 1);
+}
+
+// First and last 10kbp of each chromosome are N, like telomeres
+inline uint32_t
+telomere(SimConfig const& c) {
+  return std::min((uint32_t) 10000, c.chrlen / 10);
+}
+
+inline void
+background(SimConfig const& c, TRng& rng, uint32_t const depth, std::vector<SimRead>& reads, uint32_t& name) {
+  uint32_t tel = telomere(c);
+  uint32_t span = c.chrlen - 2 * tel - c.readlen;
+  uint64_t nreads = (uint64_t) span * depth / c.readlen;
+  // Evenly spaced with jitter, uniform random starts would give Poisson noise well above the background SD estimate
+  double step = (double) span / (double) nreads;
+  uint32_t jitter = c.readlen / 2;
+  for(uint32_t tid = 0; tid < c.nchr; ++tid) {
+    for(uint64_t k = 0; k < nreads; ++k) {
+      uint16_t flag = BAM_FPAIRED | ((k & 1) ? BAM_FREAD2 : BAM_FREAD1) | (uniform(rng, 0, 1) ? BAM_FREVERSE : 0);
+      uint32_t pos = tel + jitter + (uint32_t) (k * step);
+      reads.push_back(SimRead(tid, std::min(pos + uniform(rng, 0, 2 * jitter) - jitter, tel + span), flag, name++, 0, 0));
+    }
+  }
+}
+
+inline bool
+writeReference(SimConfig const& c, TRng& rng) {
+  boost::filesystem::path fa = c.outdir / "ref.fa";
+  std::ofstream ofs(fa.string().c_str());
+  if (!ofs.is_open()) return false;
+  char const bases[4] = {'A', 'C', 'G', 'T'};
+  uint32_t tel = telomere(c);
+  std::string line(60, 'N');
+  for(uint32_t tid = 0; tid < c.nchr; ++tid) {
+    ofs << '>' << chrName(tid) << std::endl;
+    for(uint32_t i = 0; i < c.chrlen; i += 60) {
+      uint32_t n = std::min((uint32_t) 60, c.chrlen - i);
+      for(uint32_t j = 0; j < n; ++j) {
+	if ((i + j < tel) || (i + j >= c.chrlen - tel)) line[j] = 'N';
+	else line[j] = bases[uniform(rng, 0, 3)];
+      }
+      ofs.write(line.c_str(), n);
+      ofs << '\n';
+    }
+  }
+  ofs.close();
+  return (fai_build(fa.string().c_str()) == 0);
+}
+
+inline bool
+writeAlignments(SimConfig const& c, std::string const& sample, std::vector<SimRead>& reads) {
+  std::sort(reads.begin(), reads.end());
+  boost::filesystem::path bam = c.outdir / (sample + ".bam");
+  std::string text;
+  for(uint32_t tid = 0; tid < c.nchr; ++tid) text += "@SQ\tSN:" + chrName(tid) + "\tLN:" + boost::lexical_cast<std::string>(c.chrlen) + "\n";
+  text += "@RG\tID:" + sample + "\tSM:" + sample + "\n";
+  bam_hdr_t* hdr = sam_hdr_parse(text.size(), text.c_str());
+  samFile* fp = sam_open(bam.string().c_str(), "wb");
+  if ((fp == NULL) || (hdr == NULL) || (sam_hdr_write(fp, hdr) < 0)) return false;
+  bam1_t* rec = bam_init1();
+  for(uint32_t i = 0; i < reads.size(); ++i) {
+    uint32_t cigar[2];
+    std::size_t ncigar = 1;
+    uint32_t m = c.readlen - reads[i].clip;
+    if (reads[i].layout == 0) cigar[0] = bam_cigar_gen(c.readlen, BAM_CMATCH);
+    else if (reads[i].layout == 1) {
+      cigar[0] = bam_cigar_gen(m, BAM_CMATCH);
+      cigar[1] = bam_cigar_gen(reads[i].clip, BAM_CSOFT_CLIP);
+      ncigar = 2;
+    } else {
+      cigar[0] = bam_cigar_gen(reads[i].clip, (reads[i].layout == 2) ? BAM_CSOFT_CLIP : BAM_CHARD_CLIP);
+      cigar[1] = bam_cigar_gen(m, BAM_CMATCH);
+      ncigar = 2;
+    }
+    std::string qname = "r" + boost::lexical_cast<std::string>(reads[i].name);
+    bam_set1(rec, qname.size(), qname.c_str(), reads[i].flag, reads[i].tid, reads[i].pos, 60, ncigar, cigar, -1, -1, 0, 0, NULL, NULL, 0);
+    if (sam_write1(fp, hdr, rec) < 0) return false;
+  }
+  bam_destroy1(rec);
+  bam_hdr_destroy(hdr);
+  sam_close(fp);
+  return (sam_index_build(bam.string().c_str(), 0) == 0);
+}
+
+int main(int argc, char** argv) {
+  SimConfig c;
+
+  // Parameter
+  boost::program_options::options_description generic("Options");
+  generic.add_options()
+    ("help,?", "show help message")
+    ("seed", boost::program_options::value<uint32_t>(&c.seed)->default_value(7), "random seed")
+    ("chromosomes,n", boost::program_options::value<uint32_t>(&c.nchr)->default_value(3), "number of chromosomes")
+    ("length,l", boost::program_options::value<uint32_t>(&c.chrlen)->default_value(10000000), "chromosome length")
+    ("depth,d", boost::program_options::value<uint32_t>(&c.depth)->default_value(30), "background sequencing depth")
+    ("ampdepth,a", boost::program_options::value<uint32_t>(&c.ampdepth)->default_value(120), "additional depth of amplified segments")
+    ("segments,s", boost::program_options::value<uint32_t>(&c.segments)->default_value(24), "number of planted segments")
+    ("threadlen,k", boost::program_options::value<uint32_t>(&c.threadlen)->default_value(4), "segments per templated insertion thread")
+    ("support,u", boost::program_options::value<uint32_t>(&c.support)->default_value(12), "split-reads per segment junction")
+    ("readlen,r", boost::program_options::value<uint32_t>(&c.readlen)->default_value(100), "read length")
+    ("outdir,o", boost::program_options::value<boost::filesystem::path>(&c.outdir)->default_value("bench"), "output directory")
+    ;
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::parse_command_line(argc, argv, generic), vm);
+  boost::program_options::notify(vm);
+  if (vm.count("help")) {
+    std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+    std::cout << generic << "\n";
+    return -1;
+  }
+
+  // Segments are placed in equally sized slots between the telomeres
+  uint32_t tel = telomere(c);
+  uint32_t perChr = (c.segments + c.nchr - 1) / c.nchr;
+  uint32_t slot = (perChr > 0) ? (c.chrlen - 2 * tel) / perChr : 0;
+  if ((c.nchr == 0) || (c.threadlen == 0) || (c.readlen < 40) || (c.chrlen <= 2 * tel + c.readlen) || ((c.segments > 0) && (slot < 8000))) {
+    std::cerr << "Error: Chromosomes are too short for the requested segments and read length" << std::endl;
+    return 1;
+  }
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(c.outdir, ec);
+  TRng rng(c.seed);
+
+  // Reference
+  std::cout << "Writing reference" << std::endl;
+  if (!writeReference(c, rng)) {
+    std::cerr << "Error: Reference could not be written to " << c.outdir.string() << std::endl;
+    return 1;
+  }
+
+  // Planted segments, shuffled into threads across chromosomes
+  std::vector<SimSegment> sgm;
+  for(uint32_t k = 0; k < c.segments; ++k) {
+    SimSegment s;
+    s.tid = k % c.nchr;
+    uint32_t slotStart = tel + (k / c.nchr) * slot;
+    uint32_t size = uniform(rng, 500, 3000);
+    s.start = slotStart + uniform(rng, 1000, slot - size - 1000);
+    s.end = s.start + size;
+    sgm.push_back(s);
+  }
+  std::vector<uint32_t> order(sgm.size());
+  for(uint32_t k = 0; k < order.size(); ++k) order[k] = k;
+  for(uint32_t k = order.size(); k > 1; --k) std::swap(order[k - 1], order[uniform(rng, 0, k - 1)]);
+  for(uint32_t k = 0; k < order.size(); ++k) sgm[order[k]].thread = k / c.threadlen;
+
+  // Control
+  std::cout << "Writing control" << std::endl;
+  uint32_t name = 0;
+  std::vector<SimRead> reads;
+  background(c, rng, c.depth, reads, name);
+  if (!writeAlignments(c, "control", reads)) {
+    std::cerr << "Error: Control alignments could not be written" << std::endl;
+    return 1;
+  }
+  std::vector<SimRead>().swap(reads);
+
+  // Tumor, amplified segments and split-reads joining consecutive segments of a thread
+  std::cout << "Writing tumor" << std::endl;
+  background(c, rng, c.depth, reads, name);
+  for(uint32_t k = 0; k < sgm.size(); ++k) {
+    uint32_t size = sgm[k].end - sgm[k].start;
+    uint64_t nreads = (uint64_t) size * c.ampdepth / c.readlen;
+    for(uint64_t j = 0; j < nreads; ++j) reads.push_back(SimRead(sgm[k].tid, sgm[k].start + uniform(rng, 0, size - c.readlen), BAM_FPAIRED | BAM_FREAD2, name++, 0, 0));
+  }
+  uint32_t clip = c.readlen * 3 / 10;
+  for(uint32_t k = 0; k + 1 < order.size(); ++k) {
+    SimSegment const& x = sgm[order[k]];
+    SimSegment const& y = sgm[order[k+1]];
+    if (x.thread != y.thread) continue;
+    for(uint32_t j = 0; j < c.support; ++j) {
+      uint32_t n = name++;
+      // Read 1 spans the junction from the end of x into the start of y, its mate clips at the start of x
+      reads.push_back(SimRead(x.tid, x.end - (c.readlen - clip), BAM_FPAIRED | BAM_FREAD1, n, clip, 1));
+      reads.push_back(SimRead(y.tid, y.start, BAM_FPAIRED | BAM_FREAD1 | BAM_FSUPPLEMENTARY, n, c.readlen - clip, 3));
+      reads.push_back(SimRead(x.tid, x.start, BAM_FPAIRED | BAM_FREAD2, n, clip, 2));
+    }
+  }
+  if (!writeAlignments(c, "tumor", reads)) {
+    std::cerr << "Error: Tumor alignments could not be written" << std::endl;
+    return 1;
+  }
+
+  // Truth set
+  boost::filesystem::path truth = c.outdir / "truth.bed";
+  std::ofstream ofs(truth.string().c_str());
+  ofs << "chr\tstart\tend\tthread" << std::endl;
+  for(uint32_t k = 0; k < sgm.size(); ++k) ofs << chrName(sgm[k].tid) << '\t' << sgm[k].start << '\t' << sgm[k].end << '\t' << sgm[k].thread << std::endl;
+  ofs.close();
+  std::cout << "Done." << std::endl;
+  return 0;
+}
@@ -0,0 +1,223 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <ctime>
+#include <vector>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sys/resource.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+namespace rayas
+{
+
+  // Wall and CPU seconds of one stage
+  struct StageTime {
+    double wall;
+    double cpu;
+
+    StageTime() : wall(0), cpu(0) {}
+
+    inline StageTime&
+    operator+=(StageTime const& other) {
+      wall += other.wall;
+      cpu += other.cpu;
+      return *this;
+    }
+  };
+
+  // CPU seconds of the calling thread
+  inline double
+  threadCpu() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+  }
+
+  struct Stopwatch {
+    boost::posix_time::ptime wall;
+    double cpu;
+
+    Stopwatch() : wall(boost::posix_time::microsec_clock::universal_time()), cpu(threadCpu()) {}
+
+    // Time since the last lap, must be called from the thread that started the stopwatch
+    inline StageTime
+    lap() {
+      boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+      double nowCpu = threadCpu();
+      StageTime st;
+      st.wall = (now - wall).total_microseconds() / 1000000.0;
+      st.cpu = nowCpu - cpu;
+      wall = now;
+      cpu = nowCpu;
+      return st;
+    }
+  };
+
+  // Peak resident set size of the process in MB
+  inline double
+  peakRSS() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss / 1024.0;
+  }
+
+  // Alignments of one input file
+  struct ParseStats {
+    uint64_t records;
+    uint64_t filtered;
+    uint64_t clipped;
+    uint64_t subsampled;  // Dropped beyond the depth cap
+    uint32_t spanStart;  // Window-relative span of the accepted alignments, dense tracks stay zero outside of it
+    uint32_t spanEnd;
+    double cpu;
+    bool offThread;  // Parsed by a helper thread, its CPU time is not part of the region thread's
+    bool saturated;  // A clip or coverage count exceeded the counter width
+
+    ParseStats() : records(0), filtered(0), clipped(0), subsampled(0), spanStart(std::numeric_limits<uint32_t>::max()), spanEnd(0), cpu(0), offThread(false), saturated(false) {}
+
+    // Counts of several tumors of one region
+    inline ParseStats&
+    operator+=(ParseStats const& other) {
+      records += other.records;
+      filtered += other.filtered;
+      clipped += other.clipped;
+      subsampled += other.subsampled;
+      cpu += other.cpu;
+      saturated = ((saturated) || (other.saturated));
+      return *this;
+    }
+  };
+
+  struct RegionStats {
+    int32_t tid;
+    uint32_t start;
+    uint32_t end;
+    bool restored;
+    uint32_t counters;  // Clip counter width in bits, 32 if a narrower width saturated and the region was parsed again
+    ParseStats tumor;
+    ParseStats control;
+    uint64_t tracked;
+    uint64_t candidates;
+    uint64_t breakpoints;
+    uint64_t segments;
+    StageTime parse;
+    StageTime covparams;
+    StageTime scan;
+    double peakRSS;
+
+    RegionStats() : tid(0), start(0), end(0), restored(false), counters(0), tracked(0), candidates(0), breakpoints(0), segments(0), peakRSS(0) {}
+  };
+
+  struct CallStats {
+    std::vector<RegionStats> regions;
+    uint64_t splitReads;
+    uint64_t edges;
+    uint64_t segments;
+    uint64_t confirmed;
+    StageTime link;
+    StageTime components;
+    StageTime output;
+    double wall;
+
+    CallStats() : splitReads(0), edges(0), segments(0), confirmed(0), wall(0) {}
+  };
+
+  inline void
+  printTimes(CallStats const& st, uint32_t const threads) {
+    StageTime parse;
+    StageTime covparams;
+    StageTime scan;
+    uint64_t alignments = 0;
+    uint64_t bases = 0;
+    for(uint32_t i = 0; i < st.regions.size(); ++i) {
+      parse += st.regions[i].parse;
+      covparams += st.regions[i].covparams;
+      scan += st.regions[i].scan;
+      alignments += st.regions[i].tumor.records + st.regions[i].control.records;
+      bases += st.regions[i].end - st.regions[i].start;
+    }
+    std::cout << "Stage timings in seconds (parse, covparams and scan summed over " << threads << " thread(s))" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  parse\t" << parse.wall << std::endl;
+    std::cout << "  covparams\t" << covparams.wall << std::endl;
+    std::cout << "  scan\t" << scan.wall << std::endl;
+    std::cout << "  link\t" << st.link.wall << std::endl;
+    std::cout << "  components\t" << st.components.wall << std::endl;
+    std::cout << "  output\t" << st.output.wall << std::endl;
+    std::cout << "  wall\t" << st.wall << std::endl;
+    if (st.wall > 0) std::cout << "Throughput: " << alignments << " alignments, " << (uint64_t) (alignments / st.wall) << " alignments/s, " << bases / st.wall / 1000000.0 << " Mbp/s" << std::endl;
+    std::cout << "Peak RSS: " << peakRSS() << " MB" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+  inline std::string
+  _jsonString(std::string const& str) {
+    std::string out("\"");
+    for(uint32_t i = 0; i < str.size(); ++i) {
+      if ((str[i] == '"') || (str[i] == '\\')) out += '\\';
+      out += str[i];
+    }
+    return out + "\"";
+  }
+
+  inline void
+  _jsonStage(std::ofstream& ofs, std::string const& name, StageTime const& st) {
+    ofs << _jsonString(name) << ": {\"wall\": " << st.wall << ", \"cpu\": " << st.cpu << "}";
+  }
+
+  inline void
+  _jsonParse(std::ofstream& ofs, std::string const& name, ParseStats const& ps) {
+    ofs << _jsonString(name) << ": {\"records\": " << ps.records << ", \"filtered\": " << ps.filtered << ", \"clipped\": " << ps.clipped << ", \"subsampled\": " << ps.subsampled << "}";
+  }
+
+  // Per-region counters and stage times, peakRSS is the process high-water mark once the region was done
+  inline bool
+  writeStats(boost::filesystem::path const& path, CallStats const& st, std::vector<std::string> const& chrNames) {
+    std::ofstream ofs(path.string().c_str());
+    if (!ofs.is_open()) return false;
+    ofs << std::fixed << std::setprecision(6);
+    ofs << "{" << std::endl;
+    ofs << "  \"regions\": [";
+    for(uint32_t i = 0; i < st.regions.size(); ++i) {
+      RegionStats const& rs = st.regions[i];
+      ofs << ((i) ? "," : "") << std::endl;
+      ofs << "    {\"chr\": " << _jsonString(chrNames[rs.tid]) << ", \"start\": " << rs.start << ", \"end\": " << rs.end << ", \"restored\": " << (rs.restored ? "true" : "false") << ", \"counters\": " << rs.counters << ", ";
+      _jsonParse(ofs, "tumor", rs.tumor);
+      ofs << ", ";
+      _jsonParse(ofs, "control", rs.control);
+      ofs << ", \"tracked\": " << rs.tracked << ", \"candidates\": " << rs.candidates << ", \"breakpoints\": " << rs.breakpoints << ", \"segments\": " << rs.segments << ", ";
+      _jsonStage(ofs, "parse", rs.parse);
+      ofs << ", ";
+      _jsonStage(ofs, "covparams", rs.covparams);
+      ofs << ", ";
+      _jsonStage(ofs, "scan", rs.scan);
+      ofs << ", \"peakRSS\": " << rs.peakRSS << "}";
+    }
+    ofs << std::endl << "  ]," << std::endl;
+    ofs << "  \"splitReads\": " << st.splitReads << "," << std::endl;
+    ofs << "  \"segments\": " << st.segments << "," << std::endl;
+    ofs << "  \"edges\": " << st.edges << "," << std::endl;
+    ofs << "  \"confirmed\": " << st.confirmed << "," << std::endl;
+    ofs << "  ";
+    _jsonStage(ofs, "link", st.link);
+    ofs << "," << std::endl << "  ";
+    _jsonStage(ofs, "components", st.components);
+    ofs << "," << std::endl << "  ";
+    _jsonStage(ofs, "output", st.output);
+    ofs << "," << std::endl;
+    ofs << "  \"wall\": " << st.wall << "," << std::endl;
+    ofs << "  \"peakRSS\": " << peakRSS() << std::endl;
+    ofs << "}" << std::endl;
+    ofs.close();
+    return ofs.good();
+  }
+
+}
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef TRACKS_H
+#define TRACKS_H
+
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include <htslib/bgzf.h>
+
+namespace rayas
+{
+
+  // Clip and coverage tracks of tumor and control, BGZF-compressed region records plus an index of virtual offsets
+  static char const trackMagic[8] = {'R', 'A', 'Y', 'A', 'S', 'T', 'R', 'K'};
+  static char const trackIndexMagic[8] = {'R', 'A', 'Y', 'A', 'S', 'T', 'I', 'X'};
+  static uint32_t const trackVersion = 2;
+
+  // Only the parsing parameters, the counter width and the input files, tracks are reused with any calling thresholds
+  template<typename TConfig>
+  inline uint64_t
+  trackFingerprint(TConfig const& c) {
+    std::ostringstream s;
+    s << c.minMapQual << ';' << c.minClip << ';' << c.doubleHash << ';' << c.maxDepth << ';' << c.counters << ';';
+    s << fileDigest(c.genome.string() + ".fai") << ';' << alignmentDigest(c.tumor, c.genome) << ';' << alignmentDigest(c.control, c.genome);
+    std::string str = s.str();
+    return hash_string(str.c_str(), str.size(), 0);
+  }
+
+  inline boost::filesystem::path
+  trackIndexPath(boost::filesystem::path const& path) {
+    return boost::filesystem::path(path.string() + ".tix");
+  }
+
+  struct TrackIndexEntry {
+    int32_t tid;
+    uint32_t wstart;
+    uint32_t wend;
+    uint32_t counters;  // Clip counter width in bits of the record
+    int64_t voffset;
+  };
+
+  struct TrackIndex {
+    uint64_t fingerprint;
+    std::vector<TrackIndexEntry> entries;
+
+    TrackIndex() : fingerprint(0) {}
+
+    // Latest record whose window contains [wstart, wend), a region parsed again with wider counters supersedes its earlier record
+    inline bool
+    find(int32_t const tid, uint32_t const wstart, uint32_t const wend, TrackIndexEntry& e) const {
+      for(uint32_t i = entries.size(); i > 0; --i) {
+	if ((entries[i-1].tid == tid) && (entries[i-1].wstart <= wstart) && (wend <= entries[i-1].wend)) {
+	  e = entries[i-1];
+	  return true;
+	}
+      }
+      return false;
+    }
+  };
+
+  // Track file of one worker, writers share the handle, the index and the write error flag
+  struct TrackHandle {
+    BGZF* fp;
+    bool dump;
+    bool load;
+    TrackIndex* index;
+    bool* failed;
+
+    TrackHandle() : fp(NULL), dump(false), load(false), index(NULL), failed(NULL) {}
+  };
+
+  template<typename TValue>
+  inline bool
+  _trackWrite(BGZF* fp, TValue const& val) {
+    return (bgzf_write(fp, &val, sizeof(TValue)) == (ssize_t) sizeof(TValue));
+  }
+
+  template<typename TValue>
+  inline bool
+  _trackRead(BGZF* fp, TValue& val) {
+    return (bgzf_read(fp, &val, sizeof(TValue)) == (ssize_t) sizeof(TValue));
+  }
+
+  template<typename TValue>
+  inline bool
+  _trackWriteArray(BGZF* fp, std::vector<TValue> const& v) {
+    return ((v.empty()) || (bgzf_write(fp, &v[0], v.size() * sizeof(TValue)) == (ssize_t) (v.size() * sizeof(TValue))));
+  }
+
+  // Reads a record window of slen values and keeps the len values starting at off
+  template<typename TValue>
+  inline bool
+  _trackReadArray(BGZF* fp, uint32_t const slen, uint32_t const off, uint32_t const len, std::vector<TValue>& v) {
+    v.resize(slen);
+    if ((slen) && (bgzf_read(fp, &v[0], (std::size_t) slen * sizeof(TValue)) != (ssize_t) ((std::size_t) slen * sizeof(TValue)))) return false;
+    if (off) std::copy(v.begin() + off, v.begin() + off + len, v.begin());
+    v.resize(len);
+    return true;
+  }
+
+  template<typename TChrReadPos>
+  inline bool
+  _trackWriteReads(BGZF* fp, TChrReadPos const& reads) {
+    if (!_trackWrite(fp, (uint64_t) reads.size())) return false;
+    for(uint64_t i = 0; i < reads.size(); ++i) {
+      if ((!_trackWrite(fp, reads[i].first.h1)) || (!_trackWrite(fp, reads[i].first.h2)) || (!_trackWrite(fp, reads[i].second))) return false;
+    }
+    return true;
+  }
+
+  // Split-reads outside of [wstart, wend) are dropped
+  template<typename TChrReadPos>
+  inline bool
+  _trackReadReads(BGZF* fp, uint32_t const wstart, uint32_t const wend, TChrReadPos& reads) {
+    typename TChrReadPos::value_type rp;
+    uint64_t n = 0;
+    if (!_trackRead(fp, n)) return false;
+    for(uint64_t i = 0; i < n; ++i) {
+      if ((!_trackRead(fp, rp.first.h1)) || (!_trackRead(fp, rp.first.h2)) || (!_trackRead(fp, rp.second))) return false;
+      if ((rp.second >= wstart) && (rp.second < wend)) reads.push_back(rp);
+    }
+    return true;
+  }
+
+  inline bool
+  _trackWriteStats(BGZF* fp, ParseStats const& ps) {
+    return ((_trackWrite(fp, ps.records)) && (_trackWrite(fp, ps.filtered)) && (_trackWrite(fp, ps.clipped)));
+  }
+
+  inline bool
+  _trackReadStats(BGZF* fp, ParseStats& ps) {
+    return ((_trackRead(fp, ps.records)) && (_trackRead(fp, ps.filtered)) && (_trackRead(fp, ps.clipped)));
+  }
+
+  inline BGZF*
+  openTrackWriter(boost::filesystem::path const& path, uint64_t const fingerprint) {
+    BGZF* fp = bgzf_open(path.string().c_str(), "w");
+    if (fp == NULL) return NULL;
+    if ((bgzf_write(fp, trackMagic, 8) != 8) || (!_trackWrite(fp, trackVersion)) || (!_trackWrite(fp, fingerprint))) {
+      bgzf_close(fp);
+      return NULL;
+    }
+    return fp;
+  }
+
+  // One region window: tumor and control clips and coverage, tumor split-reads, parse counts
+  // Returns false on the first short write, the file is then incomplete
+  template<typename TClipTrack, typename TCovTrack, typename TChrReadPos>
+  inline bool
+  writeTrackRecord(BGZF* fp, TrackIndex& index, int32_t const tid, uint32_t const wstart, uint32_t const wend, TClipTrack const& left, TClipTrack const& right, TCovTrack const& cov, TClipTrack const& cleft, TClipTrack const& cright, TCovTrack const& ccov, TChrReadPos const& r1, TChrReadPos const& r2, ParseStats const& tps, ParseStats const& cps) {
+    // Each record starts a new BGZF block
+    if (bgzf_flush(fp) != 0) return false;
+    TrackIndexEntry e;
+    e.tid = tid;
+    e.wstart = wstart;
+    e.wend = wend;
+    e.counters = 8 * sizeof(typename TClipTrack::value_type);
+    e.voffset = bgzf_tell(fp);
+    index.entries.push_back(e);
+    if ((!_trackWrite(fp, tid)) || (!_trackWrite(fp, wstart)) || (!_trackWrite(fp, wend)) || (!_trackWrite(fp, e.counters))) return false;
+    if ((!_trackWriteStats(fp, tps)) || (!_trackWriteStats(fp, cps))) return false;
+    if ((!_trackWriteArray(fp, left)) || (!_trackWriteArray(fp, right)) || (!_trackWriteArray(fp, cov))) return false;
+    if ((!_trackWriteArray(fp, cleft)) || (!_trackWriteArray(fp, cright)) || (!_trackWriteArray(fp, ccov))) return false;
+    return ((_trackWriteReads(fp, r1)) && (_trackWriteReads(fp, r2)));
+  }
+
+  inline bool
+  closeTrackWriter(BGZF* fp, boost::filesystem::path const& path, TrackIndex const& index) {
+    if (bgzf_close(fp) != 0) return false;
+    std::ofstream ofs(trackIndexPath(path).string().c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open()) return false;
+    ofs.write(trackIndexMagic, 8);
+    ofs.write(reinterpret_cast<char const*>(&trackVersion), sizeof(uint32_t));
+    ofs.write(reinterpret_cast<char const*>(&index.fingerprint), sizeof(uint64_t));
+    uint64_t n = index.entries.size();
+    ofs.write(reinterpret_cast<char const*>(&n), sizeof(uint64_t));
+    for(uint64_t i = 0; i < n; ++i) {
+      ofs.write(reinterpret_cast<char const*>(&index.entries[i].tid), sizeof(int32_t));
+      ofs.write(reinterpret_cast<char const*>(&index.entries[i].wstart), sizeof(uint32_t));
+      ofs.write(reinterpret_cast<char const*>(&index.entries[i].wend), sizeof(uint32_t));
+      ofs.write(reinterpret_cast<char const*>(&index.entries[i].counters), sizeof(uint32_t));
+      ofs.write(reinterpret_cast<char const*>(&index.entries[i].voffset), sizeof(int64_t));
+    }
+    ofs.close();
+    return ofs.good();
+  }
+
+  // Fails if the index is missing, damaged or the tracks were parsed with different parameters or input files
+  inline bool
+  readTrackIndex(boost::filesystem::path const& path, uint64_t const fingerprint, TrackIndex& index) {
+    std::ifstream ifs(trackIndexPath(path).string().c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) return false;
+    char magic[8];
+    uint32_t version = 0;
+    uint64_t n = 0;
+    ifs.read(magic, 8);
+    ifs.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    ifs.read(reinterpret_cast<char*>(&index.fingerprint), sizeof(uint64_t));
+    ifs.read(reinterpret_cast<char*>(&n), sizeof(uint64_t));
+    if ((!ifs.good()) || (!std::equal(magic, magic + 8, trackIndexMagic)) || (version != trackVersion) || (index.fingerprint != fingerprint)) return false;
+    index.entries.resize(n);
+    for(uint64_t i = 0; i < n; ++i) {
+      ifs.read(reinterpret_cast<char*>(&index.entries[i].tid), sizeof(int32_t));
+      ifs.read(reinterpret_cast<char*>(&index.entries[i].wstart), sizeof(uint32_t));
+      ifs.read(reinterpret_cast<char*>(&index.entries[i].wend), sizeof(uint32_t));
+      ifs.read(reinterpret_cast<char*>(&index.entries[i].counters), sizeof(uint32_t));
+      ifs.read(reinterpret_cast<char*>(&index.entries[i].voffset), sizeof(int64_t));
+    }
+    return ifs.good();
+  }
+
+  inline BGZF*
+  openTrackReader(boost::filesystem::path const& path, uint64_t const fingerprint) {
+    BGZF* fp = bgzf_open(path.string().c_str(), "r");
+    if (fp == NULL) return NULL;
+    char magic[8];
+    uint32_t version = 0;
+    uint64_t fprint = 0;
+    if ((bgzf_read(fp, magic, 8) != 8) || (!std::equal(magic, magic + 8, trackMagic)) || (!_trackRead(fp, version)) || (version != trackVersion) || (!_trackRead(fp, fprint)) || (fprint != fingerprint)) {
+      bgzf_close(fp);
+      return NULL;
+    }
+    return fp;
+  }
+
+  // Window [wstart, wend) of a record that contains it, clips and coverage are window-relative as after parsing
+  template<typename TClipTrack, typename TCovTrack, typename TChrReadPos>
+  inline bool
+  readTrackRecord(BGZF* fp, TrackIndexEntry const& e, uint32_t const wstart, uint32_t const wend, TClipTrack& left, TClipTrack& right, TCovTrack& cov, TClipTrack& cleft, TClipTrack& cright, TCovTrack& ccov, TChrReadPos& r1, TChrReadPos& r2, ParseStats& tps, ParseStats& cps) {
+    if (bgzf_seek(fp, e.voffset, SEEK_SET) < 0) return false;
+    int32_t tid = 0;
+    uint32_t rstart = 0;
+    uint32_t rend = 0;
+    uint32_t counters = 0;
+    if ((!_trackRead(fp, tid)) || (!_trackRead(fp, rstart)) || (!_trackRead(fp, rend)) || (!_trackRead(fp, counters)) || (tid != e.tid) || (rstart != e.wstart) || (rend != e.wend)) return false;
+    if ((counters != e.counters) || (counters != 8 * sizeof(typename TClipTrack::value_type))) return false;
+    if ((!_trackReadStats(fp, tps)) || (!_trackReadStats(fp, cps))) return false;
+    uint32_t slen = rend - rstart;
+    uint32_t off = wstart - rstart;
+    uint32_t len = wend - wstart;
+    if ((!_trackReadArray(fp, slen, off, len, left)) || (!_trackReadArray(fp, slen, off, len, right)) || (!_trackReadArray(fp, slen, off, len, cov))) return false;
+    if ((!_trackReadArray(fp, slen, off, len, cleft)) || (!_trackReadArray(fp, slen, off, len, cright)) || (!_trackReadArray(fp, slen, off, len, ccov))) return false;
+    if ((!_trackReadReads(fp, wstart, wend, r1)) || (!_trackReadReads(fp, wstart, wend, r2))) return false;
+    // Every position may be set
+    tps.spanStart = 0;
+    tps.spanEnd = len;
+    cps.spanStart = 0;
+    cps.spanEnd = len;
+    return true;
+  }
+
+}
+
+#endif
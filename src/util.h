@@ -1,6 +1,10 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
 #include <boost/multi_array.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/algorithm/string.hpp>
@@ -12,6 +16,7 @@
 #include <boost/lexical_cast.hpp>
 #include <htslib/sam.h>
 #include <htslib/faidx.h>
+#include <htslib/thread_pool.h>
 #include <htslib/vcf.h>
 
 namespace rayas
@@ -25,14 +30,111 @@ namespace rayas
     return slen;
   }
 
-  inline std::size_t
-  hash_string(const char *s) {
-    std::size_t h = 37;
-    while (*s) {
-      h = (h * 54059) ^ (s[0] * 76963);
-      s++;
+  inline uint64_t
+  _hashMix(uint64_t const a, uint64_t const b) {
+    __uint128_t r = (__uint128_t) a * (__uint128_t) b;
+    return ((uint64_t) r) ^ ((uint64_t) (r >> 64));
+  }
+
+  inline uint64_t
+  _hashRead64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+  }
+
+  // wyhash-style 64-bit string hash, 16 bytes per multiply-mix round
+  inline uint64_t
+  hash_string(const char* s, std::size_t const len, uint64_t seed) {
+    const uint64_t p0 = 0xa0761d6478bd642fULL;
+    const uint64_t p1 = 0xe7037ed1a0b428dbULL;
+    const uint64_t p2 = 0x8ebc6af09c88c6e3ULL;
+    seed ^= _hashMix(seed ^ p0, p1);
+    std::size_t i = len;
+    while (i > 16) {
+      seed = _hashMix(_hashRead64(s) ^ p1, _hashRead64(s + 8) ^ seed);
+      s += 16;
+      i -= 16;
     }
-    return h;
+    char tail[16] = {0};
+    std::memcpy(tail, s, i);
+    uint64_t a = _hashRead64(tail) ^ p1;
+    uint64_t b = _hashRead64(tail + 8) ^ seed;
+    return _hashMix(_hashMix(a, b) ^ p2 ^ (uint64_t) len, p1);
+  }
+
+  inline uint64_t
+  hash_string(const char* s) {
+    return hash_string(s, std::strlen(s), 0);
+  }
+
+  // Hash of the file content, 0 if the file cannot be read
+  inline uint64_t
+  fileDigest(boost::filesystem::path const& path) {
+    std::ifstream ifs(path.string().c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) return 0;
+    std::ostringstream s;
+    s << ifs.rdbuf();
+    std::string str = s.str();
+    return hash_string(str.c_str(), str.size(), 0);
+  }
+
+  // Location-independent identity of an alignment file from its size, header text and the per-contig counts of its index
+  // Copies, staged inputs and other mount points of one file share it, rewritten alignments change it
+  inline uint64_t
+  alignmentDigest(boost::filesystem::path const& path, boost::filesystem::path const& genome) {
+    std::ostringstream s;
+    boost::system::error_code ec;
+    uintmax_t size = boost::filesystem::file_size(path, ec);
+    s << (ec ? 0 : size) << ';';
+    samFile* fp = sam_open(path.string().c_str(), "r");
+    if (fp == NULL) return 0;
+    hts_set_fai_filename(fp, genome.string().c_str());
+    bam_hdr_t* hdr = sam_hdr_read(fp);
+    if (hdr != NULL) {
+      // CRAM indices have no per-contig counts, the size and header still tell files apart
+      hts_idx_t* idx = sam_index_load(fp, path.string().c_str());
+      char const* text = sam_hdr_str(hdr);
+      if (text != NULL) s.write(text, sam_hdr_length(hdr));
+      for(int32_t refIndex = 0; (idx != NULL) && (refIndex < (int32_t) hdr->n_targets); ++refIndex) {
+	uint64_t mapped = 0;
+	uint64_t unmapped = 0;
+	if (hts_idx_get_stat(idx, refIndex, &mapped, &unmapped) >= 0) s << ';' << mapped << ':' << unmapped;
+      }
+      if (idx != NULL) {
+	s << ';' << hts_idx_get_n_no_coor(idx);
+	hts_idx_destroy(idx);
+      }
+      bam_hdr_destroy(hdr);
+    }
+    sam_close(fp);
+    std::string str = s.str();
+    return hash_string(str.c_str(), str.size(), 0);
+  }
+
+  // Read identity, the second hash uses an independent seed and is only set with --double-hash, otherwise it is 0
+  struct ReadId {
+    uint64_t h1;
+    uint64_t h2;
+
+    ReadId() : h1(0), h2(0) {}
+    ReadId(uint64_t const a, uint64_t const b) : h1(a), h2(b) {}
+
+    inline bool operator<(ReadId const& other) const {
+      return ((h1 < other.h1) || ((h1 == other.h1) && (h2 < other.h2)));
+    }
+    inline bool operator==(ReadId const& other) const {
+      return ((h1 == other.h1) && (h2 == other.h2));
+    }
+  };
+
+  // Read names are not stored, a second seeded hash makes a collision of two names practically impossible
+  inline ReadId
+  readId(bam1_t const* rec, bool const doubleHash) {
+    const char* qname = bam_get_qname(rec);
+    std::size_t len = rec->core.l_qname - 1 - rec->core.l_extranul;
+    if (doubleHash) return ReadId(hash_string(qname, len, 0), hash_string(qname, len, 0x9e3779b97f4a7c15ULL));
+    return ReadId(hash_string(qname, len, 0), 0);
   }
 
 }
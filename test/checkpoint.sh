@@ -0,0 +1,32 @@
+#!/bin/bash
+# A rerun with the same --checkpoint-dir restores every region, reports it in --stats and calls the same segments
+# Copies of the inputs in another directory restore them as well
+# Checkpoints of a tumor file that was rewritten since or of another targeted region set are not restored
+set -e
+. $(dirname $0)/common.sh
+
+simulate ${W}/data
+ARGS="-l 0 -g ${W}/data/ref.fa -m ${W}/data/control.bam --checkpoint-dir ${W}/ckpt"
+${RAYAS} call ${ARGS} --stats ${W}/first.json -o ${W}/first.bed ${W}/data/tumor.bam > /dev/null
+${RAYAS} call ${ARGS} --stats ${W}/second.json -o ${W}/second.bed ${W}/data/tumor.bam > /dev/null
+
+if grep -q '"restored": true' ${W}/first.json; then fail "fresh run reports restored regions"; fi
+if grep -q '"restored": false' ${W}/second.json; then fail "rerun does not report restored regions"; fi
+if ! grep -q '"restored": true' ${W}/second.json; then fail "rerun has no regions"; fi
+same ${W}/first.bed ${W}/second.bed "restored run calls different segments"
+mkdir ${W}/copy
+cp ${W}/data/* ${W}/copy/
+${RAYAS} call -l 0 -g ${W}/copy/ref.fa -m ${W}/copy/control.bam --checkpoint-dir ${W}/ckpt --stats ${W}/copy.json -o ${W}/copy.bed ${W}/copy/tumor.bam > /dev/null
+if grep -q '"restored": false' ${W}/copy.json; then fail "checkpoints are not restored for copied input files"; fi
+same ${W}/first.bed ${W}/copy.bed "run on copied input files calls different segments"
+simulate ${W}/other -n 2 -l 2000000 -s 8 --seed 11
+cp ${W}/other/tumor.bam ${W}/data/tumor.bam
+cp ${W}/other/tumor.bam.bai ${W}/data/tumor.bam.bai
+${RAYAS} call ${ARGS} --stats ${W}/third.json -o ${W}/third.bed ${W}/data/tumor.bam > /dev/null
+if grep -q '"restored": true' ${W}/third.json; then fail "checkpoints of a rewritten tumor file are restored"; fi
+printf "sim1\t100000\t600000\n" > ${W}/a.bed
+printf "sim1\t100000\t600000\nsim2\t100000\t600000\n" > ${W}/b.bed
+${RAYAS} call ${ARGS} --bed ${W}/a.bed -o ${W}/a.out.bed ${W}/data/tumor.bam > /dev/null
+${RAYAS} call ${ARGS} --bed ${W}/b.bed --stats ${W}/b.json -o ${W}/b.out.bed ${W}/data/tumor.bam > /dev/null
+if grep -q '"restored": true' ${W}/b.json; then fail "checkpoints of another targeted region set are restored"; fi
+echo "checkpoint: ok"
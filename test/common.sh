@@ -0,0 +1,24 @@
+# Fixture shared by the shell tests: binaries, a scratch directory removed on exit, simulated data and failure reporting
+# Sourced by each test after set -e
+RAYAS=${RAYAS:-./src/rayas}
+SIMULATE=${SIMULATE:-./src/simulate}
+W=$(mktemp -d)
+trap 'rm -rf ${W}' EXIT
+
+# simulate <outdir> [simulator options], two 2Mbp chromosomes with 8 segments unless options are given
+simulate() {
+    local OUT=$1
+    shift
+    if [ $# -eq 0 ]; then set -- -n 2 -l 2000000 -s 8; fi
+    ${SIMULATE} "$@" -o ${OUT} > /dev/null
+}
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+# same <expected> <actual> <message>, fails unless both files are identical
+same() {
+    if ! cmp -s $1 $2; then fail "$3"; fi
+}
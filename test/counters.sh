@@ -0,0 +1,14 @@
+#!/bin/bash
+# An amplicon past 65535x with more than 255 split-reads per junction saturates 8-bit clips and 16-bit coverage, the region is parsed again with 32-bit counters
+set -e
+. $(dirname $0)/common.sh
+
+simulate ${W}/data -n 1 -l 200000 -s 2 -k 2 -u 300 -a 66000
+ARGS="-l 0 -g ${W}/data/ref.fa -m ${W}/data/control.bam"
+${RAYAS} call ${ARGS} --counters 8 --stats ${W}/stats.json -o ${W}/narrow.bed ${W}/data/tumor.bam > /dev/null
+${RAYAS} call ${ARGS} --counters 32 -o ${W}/wide.bed ${W}/data/tumor.bam > /dev/null
+
+if [ ! -s ${W}/wide.bed ]; then fail "32-bit run has no output"; fi
+if ! grep -q '"counters": 32' ${W}/stats.json; then fail "saturated region was not parsed again with 32-bit counters"; fi
+same ${W}/narrow.bed ${W}/wide.bed "8-bit and 32-bit counters call different segments"
+echo "counters: ok"
@@ -0,0 +1,154 @@
+#include <iostream>
+
+#include <stdint.h>
+
+#include "../src/coverage.h"
+
+using namespace rayas;
+
+static int failures = 0;
+
+#define CHECK(cond) if (!(cond)) { std::cerr << "FAIL " << __FILE__ << ':' << __LINE__ << ": " << #cond << std::endl; ++failures; }
+
+// Coverage of position i from the cumulative compact coverage
+template<typename TValue>
+inline uint64_t
+compactAt(CompactCoverage<TValue> const& cov, uint32_t const i) {
+  return cov[i+1] - cov[i];
+}
+
+int main() {
+  // More than 65535 reads starting at one base saturate 16-bit coverage instead of wrapping
+  {
+    DenseTrack<uint16_t> cov;
+    cov.reset(100);
+    for(uint32_t k = 0; k < 70000; ++k) addCoverage(cov, 10, 50, 1);
+    CHECK(finishCoverage(cov, 0, 100));
+    CHECK(cov.data[9] == 0);
+    CHECK(cov.data[10] == 65535);
+    CHECK(cov.data[59] == 65535);
+    CHECK(cov.data[60] == 0);
+  }
+
+  // Overflowed starts and ends at one base cancel, other reads stay exact
+  {
+    DenseTrack<uint16_t> cov;
+    cov.reset(100);
+    for(uint32_t k = 0; k < 70000; ++k) addCoverage(cov, 10, 5, 1);
+    for(uint32_t k = 0; k < 3; ++k) addCoverage(cov, 12, 20, 1);
+    addCoverage(cov, 15, 2, 40000);
+    addCoverage(cov, 15, 2, 40000);
+    finishCoverage(cov, 0, 100);
+    CHECK(cov.data[14] == 65535);
+    CHECK(cov.data[15] == 65535);
+    CHECK(cov.data[17] == 3);
+    CHECK(cov.data[31] == 3);
+    CHECK(cov.data[32] == 0);
+
+    // Reuse of the track
+    cov.reset(100);
+    addCoverage(cov, 0, 100, 1);
+    finishCoverage(cov, 0, 100);
+    CHECK(cov.data[0] == 1);
+    CHECK(cov.data[99] == 1);
+  }
+
+  // Weighted reads of a depth cap saturate 16-bit coverage like single ones
+  {
+    DenseTrack<uint16_t> cov;
+    cov.reset(100);
+    for(uint32_t k = 0; k < 63; ++k) addCoverage(cov, 10, 50, 1024);
+    CHECK(!finishCoverage(cov, 0, 100));
+    CHECK(cov.data[10] == 64512);
+    cov.reset(100);
+    for(uint32_t k = 0; k < 64; ++k) addCoverage(cov, 10, 50, 1024);
+    CHECK(finishCoverage(cov, 0, 100));
+    CHECK(cov.data[10] == 65535);
+  }
+
+  // 32-bit counters are exact
+  {
+    DenseTrack<uint32_t> cov;
+    cov.reset(100);
+    for(uint32_t k = 0; k < 70000; ++k) addCoverage(cov, 10, 50, 1);
+    CHECK(!finishCoverage(cov, 0, 100));
+    CHECK(cov.data[10] == 70000);
+    CHECK(cov.data[60] == 0);
+  }
+
+  // Compact coverage saturates the same way
+  {
+    CompactCoverage<uint16_t> cov(200);
+    for(uint32_t k = 0; k < 70000; ++k) addCoverage(cov, 10, 50, 1);
+    for(uint32_t k = 0; k < 3; ++k) addCoverage(cov, 12, 100, 1);
+    CHECK(finishCoverage(cov, 0, 200));
+    CHECK(cov.saturated);
+    CHECK(compactAt(cov, 9) == 0);
+    CHECK(compactAt(cov, 10) == 65535);
+    CHECK(compactAt(cov, 59) == 65535);
+    CHECK(compactAt(cov, 60) == 3);
+    CHECK(compactAt(cov, 112) == 0);
+  }
+
+  // Clip counts report when they exceed the counter width, so the region can be parsed again with wider counters
+  {
+    std::vector<uint8_t> clips(100, 0);
+    bool saturated = false;
+    for(uint32_t k = 0; k < 255; ++k) saturated |= addClip(clips, 10, 1);
+    CHECK(!saturated);
+    CHECK(clips[10] == 255);
+    CHECK(addClip(clips, 10, 1));
+    CHECK(clips[10] == 255);
+
+    std::vector<uint16_t> wide(100, 0);
+    saturated = false;
+    for(uint32_t k = 0; k < 65535; ++k) saturated |= addClip(wide, 10, 1);
+    CHECK(!saturated);
+    CHECK(addClip(wide, 10, 1));
+
+    std::vector<uint32_t> exact(100, 0);
+    for(uint32_t k = 0; k < 70000; ++k) CHECK(!addClip(exact, 10, 1));
+    CHECK(exact[10] == 70000);
+
+    SparseCounts<uint8_t> sparse;
+    for(uint32_t k = 0; k < 255; ++k) addClip(sparse, 10, 1);
+    CHECK(!finishClips(sparse));
+    CHECK(sparse[10] == 255);
+    sparse.reset();
+    for(uint32_t k = 0; k < 300; ++k) addClip(sparse, 10, 1);
+    CHECK(finishClips(sparse));
+    CHECK(sparse[10] == 255);
+  }
+
+  // Only the span of the reads is summed, the track is zero and the prefix sum constant outside of it
+  {
+    DenseTrack<uint16_t> cov;
+    SpanPrefixSum<uint32_t> cumcov;
+    cov.reset(100000);
+    addCoverage(cov, 50000, 100, 2);
+    addCoverage(cov, 50050, 100, 1);
+    finishCoverage(cov, 50000, 50150);
+    prefixSum(cov, cumcov);
+    CHECK(cumcov.size() == 100001);
+    CHECK(cumcov[0] == 0);
+    CHECK(cumcov[50000] == 0);
+    CHECK(cumcov[50050] == 100);
+    CHECK(cumcov[50100] == 250);
+    CHECK(cumcov[50150] == 300);
+    CHECK(cumcov[100000] == 300);
+
+    // Reuse for a region whose reads lie elsewhere, the earlier span is cleared
+    cov.reset(100000);
+    addCoverage(cov, 10, 10, 1);
+    finishCoverage(cov, 10, 20);
+    prefixSum(cov, cumcov);
+    CHECK(cov.data[50000] == 0);
+    CHECK(cumcov[10] == 0);
+    CHECK(cumcov[15] == 5);
+    CHECK(cumcov[100000] == 10);
+  }
+
+  if (failures) return 1;
+  std::cout << "coverage: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/bash
+# Threads, pipelining, compact storage, track files and several tumors change how regions are parsed but not the calls
+set -e
+. $(dirname $0)/common.sh
+
+simulate ${W}/data
+ARGS="-l 0 -g ${W}/data/ref.fa -m ${W}/data/control.bam"
+${RAYAS} call ${ARGS} -t 1 --dump-tracks ${W}/tracks.bin -o ${W}/base.bed ${W}/data/tumor.bam > /dev/null
+if [ ! -s ${W}/base.bed ]; then fail "single-threaded run has no output"; fi
+
+${RAYAS} call ${ARGS} -t 4 -o ${W}/threads.bed ${W}/data/tumor.bam > /dev/null
+same ${W}/base.bed ${W}/threads.bed "4 threads call different segments than 1 thread"
+${RAYAS} call ${ARGS} -t 2 --pipeline -o ${W}/pipeline.bed ${W}/data/tumor.bam > /dev/null
+same ${W}/base.bed ${W}/pipeline.bed "pipelined run calls different segments"
+${RAYAS} call ${ARGS} -t 2 --compact -o ${W}/compact.bed ${W}/data/tumor.bam > /dev/null
+same ${W}/base.bed ${W}/compact.bed "compact storage calls different segments"
+${RAYAS} call ${ARGS} -t 2 --compact --pipeline -o ${W}/compactpipe.bed ${W}/data/tumor.bam > /dev/null
+same ${W}/base.bed ${W}/compactpipe.bed "pipelined run with compact storage calls different segments"
+${RAYAS} call ${ARGS} -t 2 --tracks ${W}/tracks.bin -o ${W}/tracks.bed ${W}/data/tumor.bam > /dev/null
+same ${W}/base.bed ${W}/tracks.bed "run from track files calls different segments"
+
+# A second tumor that is a copy of the first is called the same for each tumor, alone and with the pipeline
+cp ${W}/data/tumor.bam ${W}/data/second.bam
+cp ${W}/data/tumor.bam.bai ${W}/data/second.bam.bai
+for MODE in "" "--pipeline"; do
+    rm -f ${W}/multi.*.bed
+    ${RAYAS} call ${ARGS} -t 2 ${MODE} -o ${W}/multi.bed ${W}/data/tumor.bam ${W}/data/second.bam > /dev/null
+    same ${W}/base.bed ${W}/multi.tumor.bed "first of two tumors ${MODE} calls different segments than the tumor alone"
+    same ${W}/base.bed ${W}/multi.second.bed "second of two tumors ${MODE} calls different segments than the tumor alone"
+done
+echo "equivalence: ok"
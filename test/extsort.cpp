@@ -0,0 +1,60 @@
+#include <iostream>
+
+#include <stdint.h>
+
+#include "../src/util.h"
+#include "../src/extsort.h"
+
+using namespace rayas;
+
+static int failures = 0;
+
+#define CHECK(cond) if (!(cond)) { std::cerr << "FAIL " << __FILE__ << ':' << __LINE__ << ": " << #cond << std::endl; ++failures; }
+
+// Spilled runs of 1024 records each, pushed in reverse order
+inline void
+fillSorter(ExternalSorter<SplitRead>& sorter, uint32_t const n) {
+  for(uint32_t k = n; k > 0; --k) sorter.push(SplitRead(ReadId(k, 0), 0, k));
+}
+
+int main() {
+  boost::filesystem::path tmpdir = boost::filesystem::temp_directory_path();
+
+  // Merge-streamed runs come back complete and sorted
+  {
+    ExternalSorter<SplitRead> sorter(0, tmpdir);
+    fillSorter(sorter, 5000);
+    CHECK(sorter.spilled() == 4);
+    sorter.finish();
+    SplitRead rec;
+    uint32_t n = 0;
+    while (sorter.next(rec)) {
+      ++n;
+      CHECK(rec.segment == n);
+    }
+    CHECK(n == 5000);
+    CHECK(sorter.good);
+  }
+
+  // A run cut within a record is reported instead of being read as a shorter run
+  {
+    ExternalSorter<SplitRead> sorter(0, tmpdir);
+    fillSorter(sorter, 5000);
+    boost::filesystem::resize_file(sorter.runs[0], boost::filesystem::file_size(sorter.runs[0]) - 1);
+    sorter.finish();
+    SplitRead rec;
+    while (sorter.next(rec));
+    CHECK(!sorter.good);
+  }
+
+  // Spilling into a missing directory fails
+  {
+    ExternalSorter<SplitRead> sorter(0, tmpdir / "rayas-missing-dir");
+    fillSorter(sorter, 2000);
+    CHECK(!sorter.good);
+  }
+
+  if (failures) return 1;
+  std::cout << "extsort: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+# A precomputed N-mask calls the same segments as scanning the reference, truncated or damaged masks are rejected
+set -e
+. $(dirname $0)/common.sh
+
+simulate ${W}/data
+ARGS="-l 0 -g ${W}/data/ref.fa -m ${W}/data/control.bam"
+${RAYAS} call ${ARGS} -o ${W}/scan.bed ${W}/data/tumor.bam > /dev/null
+${RAYAS} mask -o ${W}/ref.nmask ${W}/data/ref.fa > /dev/null
+${RAYAS} call ${ARGS} --nmask ${W}/ref.nmask -o ${W}/mask.bed ${W}/data/tumor.bam > /dev/null
+same ${W}/scan.bed ${W}/mask.bed "N-mask calls different segments"
+
+# Truncated before the first run, and a run count of the first contig beyond its length
+head -c 40 ${W}/ref.nmask > ${W}/truncated.nmask
+cp ${W}/ref.nmask ${W}/count.nmask
+printf '\xff\xff\xff\xff\xff\xff\xff\x7f' | dd of=${W}/count.nmask bs=1 seek=32 conv=notrunc 2> /dev/null
+for MASK in truncated count; do
+    if ${RAYAS} call ${ARGS} --nmask ${W}/${MASK}.nmask -o ${W}/${MASK}.bed ${W}/data/tumor.bam > /dev/null 2>&1; then fail "${MASK} N-mask is accepted"; fi
+done
+echo "mask: ok"
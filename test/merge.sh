@@ -0,0 +1,16 @@
+#!/bin/bash
+# Partial runs with non-default linking thresholds merge to the whole-genome result, conflicting merge options are rejected
+set -e
+. $(dirname $0)/common.sh
+
+simulate ${W}/data
+ARGS="-l 0 -s 2 -e 5000 -g ${W}/data/ref.fa -m ${W}/data/control.bam"
+${RAYAS} call ${ARGS} -o ${W}/whole.bed ${W}/data/tumor.bam > /dev/null
+for CHR in $(grep '^>' ${W}/data/ref.fa | tr -d '>'); do
+    ${RAYAS} call ${ARGS} --chr ${CHR} --partial ${W}/${CHR}.bin -o ${W}/${CHR}.bed ${W}/data/tumor.bam > /dev/null
+done
+${RAYAS} merge -o ${W}/merged.bed ${W}/*.bin > /dev/null
+
+same ${W}/whole.bed ${W}/merged.bed "merged partial files differ from the whole-genome run"
+if ${RAYAS} merge -s 3 -o ${W}/conflict.bed ${W}/*.bin > /dev/null 2>&1; then fail "merge accepts a split-read support that differs from the partial files"; fi
+echo "merge: ok"
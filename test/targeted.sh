@@ -0,0 +1,14 @@
+#!/bin/bash
+# A BED of the whole-genome segments plus a small margin calls the same segments, the background comes from the flanks
+set -e
+. $(dirname $0)/common.sh
+
+simulate ${W}/data
+ARGS="-l 0 -g ${W}/data/ref.fa -m ${W}/data/control.bam"
+${RAYAS} call ${ARGS} -o ${W}/whole.bed ${W}/data/tumor.bam > /dev/null
+tail -n +2 ${W}/whole.bed | awk 'BEGIN {OFS="\t"} {print $1, $2 - 500, $3 + 500}' > ${W}/targets.bed
+if [ ! -s ${W}/targets.bed ]; then fail "whole-genome run has no segments"; fi
+${RAYAS} call ${ARGS} --bed ${W}/targets.bed -o ${W}/targeted.bed ${W}/data/tumor.bam > /dev/null
+
+if ! diff -q <(cut -f 1-3 ${W}/whole.bed) <(cut -f 1-3 ${W}/targeted.bed) > /dev/null; then fail "targeted run calls different segments"; fi
+echo "targeted: ok"